@@ -4,6 +4,11 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace Teakra {
 
@@ -18,6 +23,43 @@ struct AHBMCallback {
     std::function<void(std::uint32_t address, std::uint32_t value)> write32;
 };
 
+struct Dsp1Info {
+    // Not applied by LoadDsp1, see there
+    std::uint16_t memory_layout;
+    bool recv_data_on_start;
+};
+
+struct JitStats {
+    // Event counters are zero when the library is built without TEAKRA_JIT_STATS
+    std::uint64_t compiled_blocks;       // including recompilations by the optimizing tier
+    std::uint64_t compiled_instructions; // DSP instructions in all compiled blocks
+    std::uint64_t lookup_hits;           // block lookups that found compiled code
+    std::uint64_t lookup_misses;         // block lookups that found no compiled code
+    std::uint64_t dispatches;            // dispatcher round-trips
+    std::uint64_t cycles;                // emulated cycles run through the JIT
+    // Current state of the code cache
+    std::uint64_t code_bytes;
+    std::uint64_t retired_code_bytes; // left behind by recompiled blocks, part of code_bytes
+    std::uint64_t cached_blocks;
+    std::uint64_t cached_pcs;
+    // (pc, number of block key variants compiled for it), most variants first
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> top_variants;
+};
+
+// Peripheral access counters, collected between SetPeripheralStats(true) and (false)
+struct PeripheralStats {
+    // by MMIO register offset, from both the DSP and the CPU side
+    std::array<std::uint64_t, 0x800> mmio_reads;
+    std::array<std::uint64_t, 0x800> mmio_writes;
+    // bytes moved by DMA, indexed [src_space][dst_space] (0 = data memory, 1 = MMIO, 7 = AHBM)
+    std::array<std::array<std::uint64_t, 8>, 8> dma_bytes;
+    // AHBM external memory callbacks by width (8, 16, 32 bit)
+    std::array<std::uint64_t, 3> ahbm_reads;
+    std::array<std::uint64_t, 3> ahbm_writes;
+    // interrupt requests by ICU IRQ number
+    std::array<std::uint64_t, 16> irqs;
+};
+
 class Processor;
 
 class Teakra {
@@ -57,6 +99,13 @@ public:
     std::uint16_t MMIORead(std::uint16_t address);
     void MMIOWrite(std::uint16_t address, std::uint16_t value);
 
+    // block versions of the above; data blocks use A32 addressing and wrap like DataReadA32.
+    // Program blocks return false, without transferring anything, if they don't fit in memory.
+    bool ProgramReadBlock(std::uint32_t address, std::span<std::uint16_t> out) const;
+    bool ProgramWriteBlock(std::uint32_t address, std::span<const std::uint16_t> data);
+    void DataReadBlock(std::uint32_t address, std::span<std::uint16_t> out) const;
+    void DataWriteBlock(std::uint32_t address, std::span<const std::uint16_t> data);
+
     // DSP_PADR is only 16-bit, so this is where the DMA interface gets the
     // upper 16-bits from
     std::uint16_t DMAChan0GetSrcHigh();
@@ -71,12 +120,82 @@ public:
     std::uint16_t AHBMRead32(std::uint32_t addr);
     void AHBMWrite32(std::uint32_t addr, std::uint32_t value);
 
+    // firmware
+    // Copies the segments of a DSP1 image into memory. Returns nullopt, leaving memory untouched,
+    // if the image is malformed. With `precompile`, the JIT compiles the entry point up front.
+    // Teakra doesn't model the memory configuration that memory_layout selects, so it is only
+    // reported; callers that emulate that configuration have to apply it themselves.
+    std::optional<Dsp1Info> LoadDsp1(std::span<const std::uint8_t> image, bool precompile = false);
+    // Compiles the code at `address` for the current register state ahead of Run. No-op without
+    // the JIT.
+    void Precompile(std::uint32_t address);
+    // Precompile list, as written by teakra_aot: the addresses and block keys the JIT has
+    // compiled, not the code. Loading one precompiles the same blocks, so that the first Run
+    // doesn't stop to compile them. It is only accepted for the program image that was in memory
+    // when it was saved. Both return false when the JIT is not in use, the file can't be
+    // accessed, or it doesn't match.
+    bool SavePrecompileList(const std::string& path);
+    bool LoadPrecompileList(const std::string& path);
+
     // core
     std::uint32_t Run(std::uint32_t cycle);
+    // runs in slices of at most `slice` cycles until `predicate` returns true or `max_cycle`
+    // cycles have elapsed. Returns the number of cycles run.
+    std::uint32_t RunUntil(std::uint32_t max_cycle, std::uint32_t slice,
+                           const std::function<bool()>& predicate);
+    // With tiered compilation, code runs on the interpreter until the JIT has reached it a few
+    // times, so that code which only runs once, like boot code, is never compiled. The JIT then
+    // compiles it without its slower optimizations, and recompiles the blocks that turn out to
+    // be hot with them. Changing the mode drops compiled code. Lockstep verification disables
+    // the interpreter tier.
+    void SetTieredCompilation(bool enabled);
+    // With background compilation, code the JIT hasn't compiled yet doesn't stall Run: a thread
+    // compiles it while the interpreter runs it. Ignored while lockstep verification is enabled,
+    // and a no-op without the JIT.
+    void SetBackgroundCompilation(bool enabled);
+    // Linux only: names every block the JIT compiles in /tmp/perf-<pid>.map, after the DSP address
+    // and block key hash, so that perf can attribute samples in JIT code
+    void SetJitPerfMap(bool enabled);
+    // Sampling profiler: every `sample_interval` emulated cycles the current DSP program counter
+    // (the block entry under the JIT) is charged with the emulated cycles and host time since the
+    // previous sample. Starting discards the previous profile. The report lists the top_n
+    // addresses by host time, with the instruction at each.
+    void StartProfiler(std::uint32_t sample_interval = 1000);
+    void StopProfiler();
+    std::string GetProfilerReport(std::size_t top_n = 32) const;
+
+    // Debugging aid for the JIT, and very slow: every block it runs is replayed on the
+    // interpreter, and the registers and memory writes of both are compared. The first divergence
+    // is printed with the block's address and instructions, and kept as the report; the report is
+    // empty until then. Enabling starts over. No-op without the JIT.
+    void SetLockstepVerification(bool enabled);
+    std::string GetLockstepReport() const;
+
+    // Execution trace in a ring buffer of the last `capacity` events: the instructions run (the
+    // blocks entered under the JIT), idle skips, interrupt entries and exits, the DSP's MMIO
+    // accesses, DMA transfers and BTDMP underruns and overruns, stamped with the emulated cycle.
+    // Starting discards the previous trace. With a `crash_path`, the trace is also written there
+    // when an assertion fails. WriteTrace may be called from any thread, also while running;
+    // trace_decoder prints the file.
+    void StartTrace(std::size_t capacity = 1 << 20, const std::string& crash_path = {});
+    void StopTrace();
+    bool WriteTrace(const std::string& path) const;
+
+    // Enabling clears the counters
+    void SetPeripheralStats(bool enabled);
+    PeripheralStats GetPeripheralStats() const;
+
+    // all zero without the JIT. `top_n` limits the length of JitStats::top_variants
+    JitStats GetJitStats(std::size_t top_n = 16) const;
 
     void SetAHBMCallback(const AHBMCallback& callback);
 
     void SetAudioCallback(std::function<void(std::array<std::int16_t, 2>)> callback);
+    // delivers interleaved stereo samples `frames` frames at a time. The samples left over are
+    // delivered as a shorter block when the DSP stops audio output, on Reset, and when the
+    // callback is replaced.
+    void SetAudioBlockCallback(std::size_t frames,
+                               std::function<void(std::span<const std::int16_t>)> callback);
 
 private:
     struct Impl;
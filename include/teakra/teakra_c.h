@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -12,6 +13,8 @@ typedef struct TeakraObject TeakraContext;
 
 typedef void (*Teakra_InterruptCallback)(void* userdata);
 typedef void (*Teakra_AudioCallback)(void* userdata, int16_t samples[2]);
+typedef void (*Teakra_AudioBlockCallback)(void* userdata, const int16_t* samples, size_t frames);
+typedef int (*Teakra_RunPredicate)(void* userdata);
 
 typedef uint8_t (*Teakra_AHBMReadCallback8)(void* userdata, uint32_t address);
 typedef void (*Teakra_AHBMWriteCallback8)(void* userdata, uint32_t address, uint8_t value);
@@ -22,6 +25,11 @@ typedef void (*Teakra_AHBMWriteCallback16)(void* userdata, uint32_t address, uin
 typedef uint32_t (*Teakra_AHBMReadCallback32)(void* userdata, uint32_t address);
 typedef void (*Teakra_AHBMWriteCallback32)(void* userdata, uint32_t address, uint32_t value);
 
+typedef struct {
+    uint16_t memory_layout;
+    bool recv_data_on_start;
+} Teakra_Dsp1Info;
+
 TeakraContext* Teakra_Create();
 void Teakra_Destroy(TeakraContext* context);
 void Teakra_Reset(TeakraContext* context);
@@ -51,6 +59,15 @@ void Teakra_DataWriteA32(TeakraContext* context, uint32_t address, uint16_t valu
 uint16_t Teakra_MMIORead(TeakraContext* context, uint16_t address);
 void Teakra_MMIOWrite(TeakraContext* context, uint16_t address, uint16_t value);
 
+// return false, without transferring anything, if the range doesn't fit in memory
+bool Teakra_ProgramReadBlock(TeakraContext* context, uint32_t address, uint16_t* out,
+                             size_t count);
+bool Teakra_ProgramWriteBlock(TeakraContext* context, uint32_t address, const uint16_t* data,
+                              size_t count);
+void Teakra_DataReadBlock(TeakraContext* context, uint32_t address, uint16_t* out, size_t count);
+void Teakra_DataWriteBlock(TeakraContext* context, uint32_t address, const uint16_t* data,
+                           size_t count);
+
 uint16_t Teakra_DMAChan0GetSrcHigh(TeakraContext* context);
 uint16_t Teakra_DMAChan0GetDstHigh(TeakraContext* context);
 
@@ -63,7 +80,14 @@ void Teakra_AHBMWrite16(TeakraContext* context, uint32_t addr, uint16_t value);
 uint16_t Teakra_AHBMRead32(TeakraContext* context, uint32_t addr);
 void Teakra_AHBMWrite32(TeakraContext* context, uint32_t addr, uint32_t value);
 
+// returns false if the image is malformed. Otherwise fills `info` with the settings of the
+// image, unless it is null. As with Teakra::LoadDsp1, memory_layout is not applied.
+bool Teakra_LoadDsp1(TeakraContext* context, const uint8_t* image, size_t size, bool precompile,
+                     Teakra_Dsp1Info* info);
+
 void Teakra_Run(TeakraContext* context, unsigned cycle);
+uint32_t Teakra_RunUntil(TeakraContext* context, uint32_t max_cycle, uint32_t slice,
+                         Teakra_RunPredicate predicate, void* userdata);
 
 void Teakra_SetAHBMCallback(TeakraContext* context, Teakra_AHBMReadCallback8 read8,
                             Teakra_AHBMWriteCallback8 write8, Teakra_AHBMReadCallback16 read16,
@@ -71,6 +95,8 @@ void Teakra_SetAHBMCallback(TeakraContext* context, Teakra_AHBMReadCallback8 rea
                             Teakra_AHBMWriteCallback32 write32, void* userdata);
 
 void Teakra_SetAudioCallback(TeakraContext* context, Teakra_AudioCallback callback, void* userdata);
+void Teakra_SetAudioBlockCallback(TeakraContext* context, size_t frames,
+                                  Teakra_AudioBlockCallback callback, void* userdata);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace Teakra {
+
+class Teakra;
+
+// Owns a fixed set of independent Teakra instances and runs them on a pool of worker threads.
+// Each worker constructs and runs its own contiguous range of instances, then takes over
+// instances from the other ranges. Run and ForEach must be called from one thread at a time.
+class TeakraPool {
+public:
+    // thread_count == 0 uses std::thread::hardware_concurrency()
+    TeakraPool(std::size_t instance_count, std::size_t thread_count = 0, bool use_jit = false);
+    ~TeakraPool();
+
+    std::size_t GetInstanceCount() const;
+    std::size_t GetThreadCount() const;
+    Teakra& GetInstance(std::size_t index);
+
+    // runs every instance for `cycle` cycles and returns when all of them are done
+    void Run(std::uint32_t cycle);
+
+    // calls `callback` once per instance on the worker threads and returns when all are done
+    void ForEach(const std::function<void(std::size_t index, Teakra& teakra)>& callback);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace Teakra
@@ -1,4 +1,5 @@
 #include <cstdio>
+#include <teakra/teakra.h>
 #include "ahbm.h"
 
 namespace Teakra {
@@ -22,6 +23,14 @@ unsigned Ahbm::Channel::GetBurstSize() {
     }
 }
 
+void Ahbm::CountAccess(Direction direction, UnitSize size) {
+    if (!stats) {
+        return;
+    }
+    auto& counters = direction == Direction::Read ? stats->ahbm_reads : stats->ahbm_writes;
+    ++counters[static_cast<u16>(size)];
+}
+
 u16 Ahbm::Read16(u16 channel, u32 address) {
     u32 value32 = Read32(channel, address);
     if ((address & 1) == 0) {
@@ -42,6 +51,7 @@ u32 Ahbm::Read32(u16 channel, u32 address) {
             u32 value = 0;
             switch (channels[channel].unit_size) {
             case UnitSize::U8:
+                CountAccess(Direction::Read, UnitSize::U8);
                 value = read_external8(current);
                 if ((current & 1) == 1) {
                     value <<= 8; // this weird bahiviour is hwtested
@@ -50,12 +60,14 @@ u32 Ahbm::Read32(u16 channel, u32 address) {
                 break;
             case UnitSize::U16: {
                 u32 current_masked = current & 0xFFFFFFFE;
+                CountAccess(Direction::Read, UnitSize::U16);
                 value = read_external16(current_masked);
                 current += 2;
                 break;
             }
             case UnitSize::U32: {
                 u32 current_masked = current & 0xFFFFFFFC;
+                CountAccess(Direction::Read, UnitSize::U32);
                 value = read_external32(current_masked);
                 current += 4;
                 break;
@@ -102,6 +114,7 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
             case UnitSize::U8: {
                 // this weird behaviour is hwtested
                 u8 value8 = ((current & 1) == 1) ? (u8)(value32 >> 8) : (u8)value32;
+                CountAccess(Direction::Write, UnitSize::U8);
                 write_external8(current, value8);
                 current += 1;
                 break;
@@ -110,8 +123,10 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
                 u32 c0 = current & 0xFFFFFFFE;
                 u32 c1 = c0 + 1;
                 if (c0 >= current) {
+                    CountAccess(Direction::Write, UnitSize::U16);
                     write_external16(c0, (u16)value32);
                 } else {
+                    CountAccess(Direction::Write, UnitSize::U8);
                     write_external8(c1, (u8)(value32 >> 8));
                 }
                 current += 2;
@@ -124,13 +139,17 @@ void Ahbm::WriteInternal(u16 channel, u32 address, u32 value) {
                 u32 c3 = c0 + 3;
 
                 if (c0 >= current && c1 >= current && c2 >= current) {
+                    CountAccess(Direction::Write, UnitSize::U32);
                     write_external32(c0, value32);
                 } else if (c2 >= current) {
                     if (c1 >= current) {
+                        CountAccess(Direction::Write, UnitSize::U8);
                         write_external8(c1, (u8)(value32 >> 8));
                     }
+                    CountAccess(Direction::Write, UnitSize::U16);
                     write_external16(c2, (u16)(value32 >> 16));
                 } else {
+                    CountAccess(Direction::Write, UnitSize::U8);
                     write_external8(c3, (u8)(value32 >> 24));
                 }
 
@@ -7,6 +7,8 @@
 
 namespace Teakra {
 
+struct PeripheralStats;
+
 class Ahbm {
 public:
     enum class UnitSize : u16 {
@@ -63,6 +65,8 @@ public:
 
     u16 GetChannelForDma(u16 dma_channel) const;
 
+    PeripheralStats* stats = nullptr; // Set while collecting peripheral stats
+
     void SetExternalMemoryCallback(std::function<u8(u32)> read8,
                                    std::function<void(u32, u8)> write8,
                                    std::function<u16(u32)> read16,
@@ -100,6 +104,7 @@ private:
     std::function<void(u32, u32)> write_external32;
 
     void WriteInternal(u16 channel, u32 address, u32 value);
+    void CountAccess(Direction direction, UnitSize size);
 };
 
 } // namespace Teakra
@@ -15,6 +15,27 @@ void Btdmp::Reset() {
     transmit_empty = true;
     transmit_full = false;
     transmit_queue = {};
+    FlushAudioBlock();
+}
+
+void Btdmp::OutputSample(std::array<std::int16_t, 2> sample) {
+    if (audio_callback) {
+        audio_callback(sample);
+    }
+    if (audio_block_callback) {
+        audio_block.insert(audio_block.end(), sample.begin(), sample.end());
+        if (audio_block.size() >= audio_block_frames * 2) {
+            audio_block_callback(audio_block);
+            audio_block.clear();
+        }
+    }
+}
+
+void Btdmp::FlushAudioBlock() {
+    if (audio_block_callback && !audio_block.empty()) {
+        audio_block_callback(audio_block);
+    }
+    audio_block.clear();
 }
 
 void Btdmp::Tick(u64 ticks) {
@@ -29,6 +50,9 @@ void Btdmp::Tick(u64 ticks) {
         std::array<std::int16_t, 2> sample;
         for (int i = 0; i < 2; ++i) {
             if (transmit_queue.empty()) {
+                if (tracer) {
+                    tracer->Record(TraceEventType::BtdmpUnderrun, trace_port);
+                }
                 std::printf("BTDMP: transmit buffer underrun\n");
                 sample[i] = 0;
             } else {
@@ -41,9 +65,7 @@ void Btdmp::Tick(u64 ticks) {
                 }
             }
         }
-        if (audio_callback) {
-            audio_callback(sample);
-        }
+        OutputSample(sample);
     }
 }
 
@@ -88,9 +110,7 @@ void Btdmp::Skip(u64 ticks) {
                 transmit_full = false;
             }
         }
-        if (audio_callback) {
-            audio_callback(sample);
-        }
+        OutputSample(sample);
     }
 }
 
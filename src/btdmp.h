@@ -5,7 +5,10 @@
 #include <functional>
 #include <utility>
 #include <queue>
+#include <span>
+#include <vector>
 #include "common_types.h"
+#include "trace.h"
 
 namespace Teakra {
 
@@ -33,6 +36,9 @@ public:
     }
 
     void SetTransmitEnable(u16 value) {
+        if (!value) {
+            FlushAudioBlock();
+        }
         transmit_enable = value;
     }
 
@@ -50,6 +56,9 @@ public:
 
     void Send(u16 value) {
         if (transmit_queue.size() == 16) {
+            if (tracer) {
+                tracer->Record(TraceEventType::BtdmpOverrun, trace_port);
+            }
             std::printf("BTDMP: transmit buffer overrun\n");
         } else {
             transmit_queue.push(value);
@@ -76,11 +85,31 @@ public:
         audio_callback = std::move(callback);
     }
 
+    /// Delivers interleaved stereo samples in blocks of `frames` frames instead of one at a time.
+    /// A partial block is delivered early when the transmitter is stopped or reset, or the
+    /// callback is replaced.
+    void SetAudioBlockCallback(std::size_t frames,
+                               std::function<void(std::span<const std::int16_t>)> callback) {
+        FlushAudioBlock();
+        audio_block_frames = frames;
+        audio_block_callback = std::move(callback);
+        audio_block.clear();
+        audio_block.reserve(frames * 2);
+    }
+
     void SetInterruptHandler(std::function<void()> handler) {
         interrupt_handler = std::move(handler);
     }
 
+    // Null to stop tracing. `port` identifies this unit in the events.
+    void SetTracer(Tracer* tracer_, u16 port) {
+        tracer = tracer_;
+        trace_port = port;
+    }
+
 private:
+    void FlushAudioBlock();
+
     // TODO: figure out the relation between clock_config and period.
     // Default to period = 4096 for now which every game uses
     u32 transmit_clock_config = 0;
@@ -91,7 +120,14 @@ private:
     bool transmit_full = false;
     std::queue<u16> transmit_queue;
     std::function<void(std::array<std::int16_t, 2>)> audio_callback;
+    std::function<void(std::span<const std::int16_t>)> audio_block_callback;
+    std::size_t audio_block_frames = 0;
+    std::vector<std::int16_t> audio_block;
     std::function<void()> interrupt_handler;
+    Tracer* tracer = nullptr;
+    u16 trace_port = 0;
+
+    void OutputSample(std::array<std::int16_t, 2> sample);
 
     class BtdmpTimingCallbacks;
 };
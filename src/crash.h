@@ -2,9 +2,15 @@
 #include <cstdio>
 #include <cstdlib>
 
+// Runs when an assertion fails, before aborting
+inline void (*crash_hook)() = nullptr;
+
 [[noreturn]] inline void Assert(const char* expression, const char* file, int line) {
     std::fflush(stdout);
     std::fprintf(stderr, "Assertion '%s' failed, file '%s' line '%d'.", expression, file, line);
+    if (crash_hook) {
+        crash_hook();
+    }
     std::abort();
 }
 
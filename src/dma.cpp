@@ -1,8 +1,10 @@
 #include <cstdio>
 #include <cstring>
+#include <teakra/teakra.h>
 #include "ahbm.h"
 #include "dma.h"
 #include "shared_memory.h"
+#include "trace.h"
 
 namespace Teakra {
 
@@ -14,6 +16,11 @@ void Dma::Reset() {
 
 void Dma::DoDma(u16 channel) {
     channels[channel].Start();
+    if (tracer) {
+        tracer->Record(TraceEventType::DmaStart, channel,
+                       static_cast<u16>(channels[channel].src_space << 8 |
+                                        channels[channel].dst_space));
+    }
 
     channels[channel].ahbm_channel = ahbm.GetChannelForDma(channel);
 
@@ -21,6 +28,9 @@ void Dma::DoDma(u16 channel) {
     while (channels[channel].running)
         channels[channel].Tick(*this);
 
+    if (tracer) {
+        tracer->Record(TraceEventType::DmaFinish, channel);
+    }
     interrupt_handler();
 }
 
@@ -35,6 +45,9 @@ void Dma::Channel::Start() {
 
 void Dma::Channel::Tick(Dma& parent) {
     static constexpr u32 DataMemoryOffset = 0x20000;
+    if (parent.stats && src_space < 8 && dst_space < 8) {
+        parent.stats->dma_bytes[src_space][dst_space] += dword_mode ? 4 : 2;
+    }
     if (dword_mode) {
         u32 value = 0;
         switch (src_space) {
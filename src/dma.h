@@ -8,6 +8,8 @@ namespace Teakra {
 
 struct SharedMemory;
 class Ahbm;
+struct PeripheralStats;
+class Tracer;
 
 class Dma {
 public:
@@ -165,6 +167,9 @@ public:
         interrupt_handler = std::move(handler);
     }
 
+    PeripheralStats* stats = nullptr; // Set while collecting peripheral stats
+    Tracer* tracer = nullptr;         // Set while tracing
+
 private:
     std::function<void()> interrupt_handler;
 
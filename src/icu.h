@@ -5,6 +5,7 @@
 #include <functional>
 #include <mutex>
 #include <utility>
+#include <teakra/teakra.h>
 #include "common_types.h"
 
 namespace Teakra {
@@ -29,6 +30,9 @@ public:
         request |= bits;
         for (u32 irq = 0; irq < 16; ++irq) {
             if (bits[irq]) {
+                if (stats) {
+                    ++stats->irqs[irq];
+                }
                 for (u32 interrupt = 0; interrupt < enabled.size(); ++interrupt) {
                     if (enabled[interrupt][irq]) {
                         on_interrupt(interrupt);
@@ -76,7 +80,13 @@ public:
     std::array<u16, 16> vector_low, vector_high;
     std::array<u16, 16> vector_context_switch;
 
+    void SetStats(PeripheralStats* stats_) {
+        std::lock_guard lock(mutex);
+        stats = stats_;
+    }
+
 private:
+    PeripheralStats* stats = nullptr;
     std::function<void(u32)> on_interrupt;
     std::function<void(u32, bool)> on_vectored_interrupt;
 
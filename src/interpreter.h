@@ -1,5 +1,6 @@
 #pragma once
 #include <atomic>
+#include <cstring>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
@@ -13,7 +14,9 @@
 #include "memory_interface.h"
 #include "mmio.h"
 #include "operand.h"
+#include "profiler.h"
 #include "register.h"
+#include "trace.h"
 
 namespace Teakra {
 
@@ -63,16 +66,62 @@ public:
 
     bool compiling = false;
 
+    /// Executes the instruction at pc, after the rep and block repeat bookkeeping that goes with
+    /// fetching it. Shared by every way of running, so that they can't disagree. Returns the pc
+    /// execution continues at unless the instruction transfers control.
+    u32 Step() {
+        u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+        auto& decoder = decoders[opcode];
+        u16 expand_value = 0;
+        if (decoder.NeedExpansion()) {
+            expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+        }
+
+        if (regs.rep) {
+            if (regs.repc == 0) {
+                regs.rep = false;
+            } else {
+                --regs.repc;
+                --regs.pc;
+            }
+        }
+
+        if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
+            if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
+                --regs.bcn;
+                regs.lp = regs.bcn != 0;
+            } else {
+                --regs.bkrep_stack[regs.bcn - 1].lc;
+                regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
+            }
+        }
+
+        const u32 fallthrough_pc = regs.pc;
+        decoder.call(*this, opcode, expand_value);
+        return fallthrough_pc;
+    }
+
     u32 Run(u64 cycles) {
         idle = false;
+        poll_snapshot_valid = false;
         for (u64 i = 0; i < cycles; ++i) {
-            if (idle) {
+            if (idle || std::exchange(poll_idle, false)) {
                 u64 skipped = core_timing.Skip(cycles - i - 1);
                 i += skipped;
+                if (profiler) {
+                    profiler->Advance(regs.pc, skipped);
+                }
+                if (tracer) {
+                    tracer->Record(TraceEventType::Idle, regs.pc);
+                    tracer->Advance(skipped);
+                }
 
                 // Skip additional tick so to let components fire interrupts
                 if (i < cycles - 1) {
                     ++i;
+                    if (tracer) {
+                        tracer->Advance(1);
+                    }
                     core_timing.Tick();
                 }
             }
@@ -87,33 +136,22 @@ public:
                 regs.ipv = 1;
             }
 
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
+            if (profiler) {
+                profiler->Advance(regs.pc, 1);
             }
-
-            if (regs.rep) {
-                if (regs.repc == 0) {
-                    regs.rep = false;
-                } else {
-                    --regs.repc;
-                    --regs.pc;
-                }
+            if (tracer) {
+                tracer->Instruction(regs.pc);
             }
 
-            if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
-                if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
-                    --regs.bcn;
-                    regs.lp = regs.bcn != 0;
-                } else {
-                    --regs.bkrep_stack[regs.bcn - 1].lc;
-                    regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
-                }
-            }
+            const u32 instruction_pc = regs.pc;
+            const u32 fallthrough_pc = Step();
 
-            decoder.call(*this, opcode, expand_value);
+            // Any way back to an earlier address closes a loop, like a JIT block that dispatches
+            // itself again: br, brr, call, ret, the end of a bkrep body. rep is excluded, since its
+            // counter changes every time.
+            if (regs.pc <= instruction_pc && !regs.rep && !idle) {
+                DetectPollLoop();
+            }
 
             // I am not sure if a single-instruction loop is interruptable and how it is handled,
             // so just disable interrupt for it for now.
@@ -127,6 +165,11 @@ public:
                         regs.pc = 0x0006 + i * 8;
                         idle = false;
                         interrupt_handled = true;
+                        if (tracer) {
+                            tracer->in_interrupt = true;
+                            tracer->Record(TraceEventType::InterruptEnter, regs.pc,
+                                           static_cast<u16>(i));
+                        }
                         if (regs.ic[i]) {
                             ContextStore();
                         }
@@ -139,6 +182,10 @@ public:
                     PushPC();
                     regs.pc = vinterrupt_address;
                     idle = false;
+                    if (tracer) {
+                        tracer->in_interrupt = true;
+                        tracer->Record(TraceEventType::InterruptEnter, regs.pc, 3);
+                    }
                     if (vinterrupt_context_switch) {
                         ContextStore();
                     }
@@ -146,10 +193,33 @@ public:
             }
 
             core_timing.Tick();
+
+            if (stop_at_branch && regs.pc != fallthrough_pc) {
+                cycles_run = i + 1;
+                return 0;
+            }
         }
+        cycles_run = cycles;
         return 0;
     }
 
+    /// Runs like Run, but returns after the first instruction that branches or takes an interrupt,
+    /// where a JIT block would end. Returns the number of cycles run.
+    u64 RunToBranch(u64 cycles) {
+        stop_at_branch = true;
+        Run(cycles);
+        stop_at_branch = false;
+        return cycles_run;
+    }
+
+    // Executes `cycles` instructions without idle skipping, interrupts or timer ticks, for lockstep
+    // verification to replay a JIT block
+    void Replay(u64 cycles) {
+        for (u64 i = 0; i < cycles; ++i) {
+            Step();
+        }
+    }
+
     void RunWithJit(u64 cycles) {
         if (idle) {
             u64 skipped = core_timing.Skip(total_cycles - 1);
@@ -173,33 +243,7 @@ public:
         }
 
         for (u64 i = 0; i < cycles; ++i) {
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            }
-
-            if (regs.rep) {
-                if (regs.repc == 0) {
-                    regs.rep = false;
-                } else {
-                    --regs.repc;
-                    --regs.pc;
-                }
-            }
-
-            if (regs.lp && regs.bkrep_stack[regs.bcn - 1].end + 1 == regs.pc) {
-                if (regs.bkrep_stack[regs.bcn - 1].lc == 0) {
-                    --regs.bcn;
-                    regs.lp = regs.bcn != 0;
-                } else {
-                    --regs.bkrep_stack[regs.bcn - 1].lc;
-                    regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
-                }
-            }
-
-            decoder.call(*this, opcode, expand_value);
+            Step();
         }
 
         // I am not sure if a single-instruction loop is interruptable and how it is handled,
@@ -1200,6 +1244,21 @@ public:
         compiling = false;
     }
 
+    // Going back to the same address twice in a row with identical registers and no memory
+    // writes in between means the loop can only be waiting on MMIO state that changes with the
+    // next event, so skip ahead to it once.
+    void DetectPollLoop() {
+        static_assert(std::is_trivially_copyable_v<RegisterState>);
+        if (poll_snapshot_valid && poll_write_count == mem.write_count &&
+            std::memcmp(&poll_snapshot, &regs, sizeof(RegisterState)) == 0) {
+            poll_idle = true;
+            return;
+        }
+        std::memcpy(&poll_snapshot, &regs, sizeof(RegisterState));
+        poll_write_count = mem.write_count;
+        poll_snapshot_valid = true;
+    }
+
     void break_() {
         ASSERT(regs.lp);
         --regs.bcn;
@@ -1279,6 +1338,10 @@ public:
         if (regs.ConditionPass(c)) {
             PopPC();
             regs.ie = 1;
+            if (tracer) {
+                tracer->in_interrupt = false;
+                tracer->Record(TraceEventType::InterruptExit, regs.pc);
+            }
         }
     }
     void retic(Cond c) {
@@ -1286,6 +1349,10 @@ public:
             PopPC();
             regs.ie = 1;
             ContextRestore();
+            if (tracer) {
+                tracer->in_interrupt = false;
+                tracer->Record(TraceEventType::InterruptExit, regs.pc);
+            }
         }
     }
     void retid() {
@@ -3035,6 +3102,15 @@ public:
     std::atomic<u32> vinterrupt_address;
 
     bool idle = false;
+    bool stop_at_branch = false; // See RunToBranch
+    u64 cycles_run = 0;          // Cycles the last Run executed
+    Profiler* profiler = nullptr; // Set while profiling
+    Tracer* tracer = nullptr;     // Set while tracing
+
+    RegisterState poll_snapshot;
+    u64 poll_write_count = 0;
+    bool poll_snapshot_valid = false;
+    bool poll_idle = false;
 
     u64 GetAcc(RegName name) const {
         switch (name) {
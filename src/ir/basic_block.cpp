@@ -1,13 +1,13 @@
 #include "basic_block.h"
 
 #include <algorithm>
+#include <cinttypes>
+#include <cstdio>
 #include <initializer_list>
-#include <map>
 #include <string>
 
-#include <fmt/format.h>
 #include "crash.h"
-
+#include "ir/opcode.h"
 #include "memory_pool.h"
 #include "operand.h"
 
@@ -32,10 +32,10 @@ Block::iterator Block::PrependNewInst(iterator insertion_point, Opcode opcode,
     IR::Inst* inst = new (instruction_alloc_pool->Alloc()) IR::Inst(opcode);
     ASSERT(args.size() == inst->NumArgs());
 
-    /*std::for_each(args.begin(), args.end(), [&inst, index = size_t(0)](const auto& arg) mutable {
+    std::for_each(args.begin(), args.end(), [&inst, index = size_t(0)](const auto& arg) mutable {
         inst->SetArg(index, arg);
         index++;
-    });*/
+    });
 
     return instructions.insert_before(insertion_point, inst);
 }
@@ -80,6 +80,14 @@ bool Block::HasConditionFailedLocation() const {
     return cond_failed.has_value();
 }
 
+const StaticRegs& Block::EntryState() const {
+    return entry_state;
+}
+
+void Block::SetEntryState(const StaticRegs& state) {
+    entry_state = state;
+}
+
 Block::InstructionList& Block::Instructions() {
     return instructions;
 }
@@ -154,45 +162,47 @@ TerminalToString(terminal.else_));
     return "";
 }*/
 
+template <typename... Args>
+static std::string Format(const char* format, Args... args) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), format, args...);
+    return buffer;
+}
+
 std::string DumpBlock(const IR::Block& block) {
-    /*std::string ret;
+    std::string ret;
 
-    ret += fmt::format("Block: location={}\n", block.Location());
-    ret += fmt::format("cycles={}", block.CycleCount());
-    ret += fmt::format(", entry_cond={}", A64::CondToString(block.GetCondition()));
-    if (block.GetCondition() != Cond::AL) {
-        ret += fmt::format(", cond_fail={}", block.ConditionFailedLocation());
-    }
-    ret += '\n';
+    ret += Format("Block: location=%05" PRIx64 "-%05" PRIx64 "\n", block.Location().Value(),
+                  block.EndLocation().Value());
+    ret += Format("cycles=%zu", block.CycleCount());
+    const StaticRegs& state = block.EntryState();
+    ret += Format(", sat=%d, sata=%d, hwm=%d, page=%02x\n", state.sat, state.sata, state.hwm,
+                  state.page);
 
     const auto arg_to_string = [](const IR::Value& arg) -> std::string {
         if (arg.IsEmpty()) {
             return "<null>";
         } else if (!arg.IsImmediate()) {
-            if (const unsigned name = arg.GetInst()->GetName()) {
-                return fmt::format("%{}", name);
+            if (const u32 name = arg.GetInst()->GetName()) {
+                return Format("%%%u", name);
             }
-            return fmt::format("%<unnamed inst {:016x}>", reinterpret_cast<u64>(arg.GetInst()));
+            return Format("%%<unnamed inst %p>", static_cast<void*>(arg.GetInst()));
         }
         switch (arg.GetType()) {
         case Type::U1:
-            return fmt::format("#{}", arg.GetU1() ? '1' : '0');
+            return Format("#%d", arg.GetU1() ? 1 : 0);
         case Type::U8:
-            return fmt::format("#{}", arg.GetU8());
+            return Format("#%u", arg.GetU8());
         case Type::U16:
-            return fmt::format("#{:#x}", arg.GetU16());
+            return Format("#0x%x", arg.GetU16());
+        case Type::S16:
+            return Format("#%d", arg.GetS16());
         case Type::U32:
-            return fmt::format("#{:#x}", arg.GetU32());
+            return Format("#0x%x", arg.GetU32());
         case Type::U64:
-            return fmt::format("#{:#x}", arg.GetU64());
-        case Type::A32Reg:
-            return A32::RegToString(arg.GetA32RegRef());
-        case Type::A32ExtReg:
-            return A32::ExtRegToString(arg.GetA32ExtRegRef());
-        case Type::A64Reg:
-            return A64::RegToString(arg.GetA64RegRef());
-        case Type::A64Vec:
-            return A64::VecToString(arg.GetA64VecRef());
+            return Format("#0x%" PRIx64, arg.GetU64());
+        case Type::Reg:
+            return Format("$%d", static_cast<int>(arg.GetRegName()));
         default:
             return "<unknown immediate type>";
         }
@@ -201,15 +211,14 @@ std::string DumpBlock(const IR::Block& block) {
     for (const auto& inst : block) {
         const Opcode op = inst.GetOpcode();
 
-        ret += fmt::format("[{:016x}] ", reinterpret_cast<u64>(&inst));
         if (GetTypeOf(op) != Type::Void) {
             if (inst.GetName()) {
-                ret += fmt::format("%{:<5} = ", inst.GetName());
+                ret += Format("%%%-5u = ", inst.GetName());
             } else {
                 ret += "noname = ";
             }
         } else {
-            ret += "         ";  // '%00000 = ' -> 1 + 5 + 3 = 9 spaces
+            ret += "         "; // '%00000 = ' -> 1 + 5 + 3 = 9 spaces
         }
 
         ret += GetNameOf(op);
@@ -221,23 +230,21 @@ std::string DumpBlock(const IR::Block& block) {
             ret += arg_index != 0 ? ", " : " ";
             ret += arg_to_string(arg);
 
-            Type actual_type = arg.GetType();
-            Type expected_type = GetArgTypeOf(op, arg_index);
+            const Type actual_type = arg.GetType();
+            const Type expected_type = GetArgTypeOf(op, arg_index);
             if (!AreTypesCompatible(actual_type, expected_type)) {
-                ret += fmt::format("<type error: {} != {}>", GetNameOf(actual_type),
-    GetNameOf(expected_type));
+                ret += "<type error: ";
+                ret += GetNameOf(actual_type);
+                ret += " != ";
+                ret += GetNameOf(expected_type);
+                ret += ">";
             }
         }
 
-        ret += fmt::format(" (uses: {})", inst.UseCount());
-
-        ret += '\n';
+        ret += Format(" (uses: %zu)\n", inst.UseCount());
     }
 
-    ret += "terminal = " + TerminalToString(block.GetTerminal()) + '\n';
-
-    return ret;*/
-    return "";
+    return ret;
 }
 
 } // namespace Teakra::IR
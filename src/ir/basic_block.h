@@ -6,9 +6,9 @@
 #include <string>
 
 #include <mcl/container/intrusive_list.hpp>
-#include <mcl/stdint.hpp>
 
-#include "microinstruction.h"
+#include "common_types.h"
+#include "ir/microinstruction.h"
 
 namespace Teakra::Common {
 class Pool;
@@ -46,6 +46,7 @@ struct StaticRegs {
     bool sat = false; // 1-bit, disable saturation when moving from acc
     bool sata = true; // 1-bit, disable saturation when moving to acc
     u16 hwm = 0;      // 2-bit, half word mode, modify y on multiplication
+    u16 page = 0;     // 8-bit, data memory page for MemImm8 operands
 };
 
 enum class Opcode;
@@ -193,6 +194,11 @@ public:
     /// Determines whether or not this basic block has a terminal instruction.
     bool HasTerminal() const;
 
+    /// Gets the static register state expected on entry to this block.
+    const StaticRegs& EntryState() const;
+    /// Sets the static register state expected on entry to this block.
+    void SetEntryState(const StaticRegs& state);
+
     /// Gets a mutable reference to the cycle count for this basic block.
     size_t& CycleCount();
     /// Gets an immutable reference to the cycle count for this basic block.
@@ -3,7 +3,15 @@
 namespace Teakra::IR {
 
 u32 IREmitter::PC() const {
-    return 0;
+    return static_cast<u32>(current_location.Value());
+}
+
+void IREmitter::SetPC(u32 pc) {
+    current_location = LocationDescriptor{pc};
+}
+
+U1 IREmitter::Imm1(bool imm) const {
+    return U1(Value(imm));
 }
 
 U8 IREmitter::Imm8(u8 imm) const {
@@ -18,16 +26,12 @@ U32 IREmitter::Imm32(u32 imm32) const {
     return U32(Value(imm32));
 }
 
-U16 IREmitter::GetRegister16(RegName source_reg) {
-    return Inst<U16>(Opcode::GetRegister16, Value(source_reg));
+U64 IREmitter::Imm64(u64 imm64) const {
+    return U64(Value(imm64));
 }
 
-U32 IREmitter::GetXFactor(u32 unit) {
-    return Inst<U32>(Opcode::GetXFactor, IR::Value(unit));
-}
-
-U32 IREmitter::GetYFactor(u32 unit) {
-    return Inst<U32>(Opcode::GetYFactor, IR::Value(unit));
+U16 IREmitter::GetRegister16(RegName source_reg) {
+    return Inst<U16>(Opcode::GetRegister16, Value(source_reg));
 }
 
 U64 IREmitter::GetAcc(RegName source_reg) {
@@ -35,67 +39,59 @@ U64 IREmitter::GetAcc(RegName source_reg) {
 }
 
 void IREmitter::SetRegister16(RegName reg, const U16& value) {
-    Inst(Opcode::SetRegister16, IR::Value(reg), value);
+    Inst(Opcode::SetRegister16, Value(reg), value);
 }
 
 void IREmitter::SetAcc(RegName reg, const U64& value) {
-    Inst(Opcode::SetAcc, Value(reg), Value(value));
-}
-
-void IREmitter::SetProduct(u32 unit, const U32& value) {
-    Inst(Opcode::SetProduct, IR::Value(unit), value);
+    Inst(Opcode::SetAcc, Value(reg), value);
 }
 
 void IREmitter::SetAccFlag(const U64& value) {
-    Inst(Opcode::SetAccFlag, Value(value));
+    Inst(Opcode::SetAccFlag, value);
 }
 
 U64 IREmitter::SaturateAcc(const U64& value, bool flag) {
-    return Inst<U64>(Opcode::SaturateAcc, value, Value(flag));
-}
-
-U32 IREmitter::LogicalShiftLeft32(const U32& value, const U8& shift) {
-    return Inst<U32>(Opcode::LogicalShiftLeft32, value, shift);
+    return Inst<U64>(Opcode::SaturateAcc, value, Imm1(flag));
 }
 
-U32 IREmitter::LogicalShiftRight32(const U32& value, const U8& shift) {
-    return Inst<U32>(Opcode::LogicalShiftRight32, value, shift);
+U64 IREmitter::SignExtend64(const U64& value, u8 bits) {
+    return Inst<U64>(Opcode::SignExtend64, value, Imm8(bits));
 }
 
-U32 IREmitter::And32(const U32& a, const U32& b) {
-    return Inst<U32>(Opcode::And32, a, b);
+U64 IREmitter::ZeroExtend16To64(const U16& value) {
+    return Inst<U64>(Opcode::ZeroExtend16To64, value);
 }
 
-U32 IREmitter::SignExtend32(const U32& value, const U8& bits) {
-    return Inst<U32>(Opcode::SignExtend32, value, bits);
+U64 IREmitter::LogicalShiftLeft64(const U64& value, const U8& shift) {
+    return Inst<U64>(Opcode::LogicalShiftLeft64, value, shift);
 }
 
-U16 IREmitter::Add16(const U16& a, const U16& b) {
-    return Inst<U16>(Opcode::Add16, a, b);
+U64 IREmitter::LogicalShiftRight64(const U64& value, const U8& shift) {
+    return Inst<U64>(Opcode::LogicalShiftRight64, value, shift);
 }
 
-U16 IREmitter::Sub16(const U16& a, const U16& b) {
-    return Inst<U16>(Opcode::Sub16, a, b);
+U64 IREmitter::And64(const U64& a, const U64& b) {
+    return Inst<U64>(Opcode::And64, a, b);
 }
 
-U32 IREmitter::Mul32(const U32& a, const U32& b) {
-    return Inst<U32>(Opcode::Mul32, a, b);
+U64 IREmitter::Or64(const U64& a, const U64& b) {
+    return Inst<U64>(Opcode::Or64, a, b);
 }
 
-U1 IREmitter::TestBit(const U32& value, const U8& bit) {
-    return Inst<U1>(Opcode::TestBit, value, bit);
+U64 IREmitter::Xor64(const U64& a, const U64& b) {
+    return Inst<U64>(Opcode::Xor64, a, b);
 }
 
-U16 IREmitter::ExtractHalf32(const U32& value, u8 half) {
-    return Inst<U16>(Opcode::ExtractHalf32, value, IR::Value(half));
+U16 IREmitter::ExtractHalf64(const U64& value, u8 half) {
+    return Inst<U16>(Opcode::ExtractHalf64, value, Imm8(half));
 }
 
-U16 IREmitter::ExtractHalf64(const U64& value, u8 half) {
-    return Inst<U16>(Opcode::ExtractHalf64, value, IR::Value(half));
+U16 IREmitter::Add16(const U16& a, const U16& b) {
+    return Inst<U16>(Opcode::Add16, a, b);
 }
 
-U32 IREmitter::Pack2x16To1x32(const U16& l, const U16& h) {
-    return Inst<U32>(Opcode::Pack2x16To1x32, l, h);
+U16 IREmitter::Sub16(const U16& a, const U16& b) {
+    return Inst<U16>(Opcode::Sub16, a, b);
 }
 
 U16 IREmitter::ReadMemory16(const U16& address) {
@@ -106,4 +102,8 @@ void IREmitter::WriteMemory16(const U16& address, const U16& data) {
     Inst(Opcode::WriteMemory16, address, data);
 }
 
+void IREmitter::SetInsertionPoint(Block::iterator new_insertion_point) {
+    insertion_point = new_insertion_point;
+}
+
 } // namespace Teakra::IR
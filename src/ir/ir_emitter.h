@@ -8,41 +8,44 @@ namespace Teakra::IR {
 class IREmitter {
 public:
     explicit IREmitter(Block& block_, LocationDescriptor descriptor)
-        : block(block_), current_location(descriptor) {}
+        : block(block_), current_location(descriptor), insertion_point(block_.end()) {}
+
+    Block& block;
 
     u32 PC() const;
+    void SetPC(u32 pc);
+
+    U1 Imm1(bool value) const;
     U8 Imm8(u8 value) const;
     U16 Imm16(u16 value) const;
     U32 Imm32(u32 value) const;
+    U64 Imm64(u64 value) const;
 
     U16 GetRegister16(RegName reg);
-    U32 GetXFactor(u32 unit);
-    U32 GetYFactor(u32 unit);
     U64 GetAcc(RegName reg);
     void SetRegister16(RegName reg, const U16& value);
     void SetAcc(RegName reg, const U64& value);
-    void SetProduct(u32 unit, const U32& value);
 
     void SetAccFlag(const U64& value);
     U64 SaturateAcc(const U64& value, bool flag);
 
-    U32 LogicalShiftLeft32(const U32& value, const U8& shift);
-    U32 LogicalShiftRight32(const U32& value, const U8& shift);
-    U32 And32(const U32& a, const U32& b);
-    U32 SignExtend32(const U32& value, const U8& bits);
+    U64 SignExtend64(const U64& value, u8 bits);
+    U64 ZeroExtend16To64(const U16& value);
+    U64 LogicalShiftLeft64(const U64& value, const U8& shift);
+    U64 LogicalShiftRight64(const U64& value, const U8& shift);
+    U64 And64(const U64& a, const U64& b);
+    U64 Or64(const U64& a, const U64& b);
+    U64 Xor64(const U64& a, const U64& b);
+    U16 ExtractHalf64(const U64& value, u8 half);
 
     U16 Add16(const U16& a, const U16& b);
     U16 Sub16(const U16& a, const U16& b);
-    U32 Mul32(const U32& a, const U32& b);
-
-    U1 TestBit(const U32& value, const U8& bit);
-    U16 ExtractHalf32(const U32& value, u8 half);
-    U16 ExtractHalf64(const U64& value, u8 half);
-    U32 Pack2x16To1x32(const U16& l, const U16& h);
 
     U16 ReadMemory16(const U16& address);
     void WriteMemory16(const U16& address, const U16& data);
 
+    void SetInsertionPoint(Block::iterator new_insertion_point);
+
 private:
     template <typename T = Value, typename... Args>
     T Inst(Opcode op, Args... args) {
@@ -50,8 +53,6 @@ private:
         return T(Value(&*iter));
     }
 
-private:
-    Block& block;
     LocationDescriptor current_location;
     Block::iterator insertion_point;
 };
@@ -1 +1,129 @@
-#include "microinstruction.h"
+#include <algorithm>
+
+#include "ir/microinstruction.h"
+#include "ir/opcode.h"
+
+namespace Teakra::IR {
+
+bool Inst::AccessesRegister() const {
+    switch (op) {
+    case Opcode::GetRegister16:
+    case Opcode::GetAcc:
+    case Opcode::SetRegister16:
+    case Opcode::SetAcc:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool Inst::AccessesMemory() const {
+    switch (op) {
+    case Opcode::ReadMemory16:
+    case Opcode::WriteMemory16:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool Inst::WritesToFlags() const {
+    switch (op) {
+    case Opcode::SetAccFlag:
+        return true;
+
+    case Opcode::SaturateAcc:
+        // Saturation may set flm
+        return !args[1].IsImmediate() || args[1].GetU1();
+
+    default:
+        return false;
+    }
+}
+
+bool Inst::MayHaveSideEffects() const {
+    switch (op) {
+    case Opcode::SetRegister16:
+    case Opcode::SetAcc:
+        return true;
+
+    default:
+        // Reads may hit MMIO, which can change device state
+        return AccessesMemory() || WritesToFlags();
+    }
+}
+
+bool Inst::AreAllArgsImmediates() const {
+    return std::all_of(args.begin(), args.begin() + NumArgs(),
+                       [](const auto& value) { return value.IsImmediate(); });
+}
+
+Type Inst::GetType() const {
+    if (op == Opcode::Identity) {
+        return args[0].GetType();
+    }
+    return GetTypeOf(op);
+}
+
+size_t Inst::NumArgs() const {
+    return GetNumArgsOf(op);
+}
+
+Value Inst::GetArg(size_t index) const {
+    ASSERT(index < GetNumArgsOf(op));
+    ASSERT(!args[index].IsEmpty());
+
+    return args[index];
+}
+
+void Inst::SetArg(size_t index, Value value) {
+    ASSERT(index < GetNumArgsOf(op));
+    ASSERT(AreTypesCompatible(value.GetType(), GetArgTypeOf(op, index)));
+
+    if (!args[index].IsImmediate()) {
+        UndoUse(args[index]);
+    }
+    if (!value.IsImmediate()) {
+        Use(value);
+    }
+
+    args[index] = value;
+}
+
+void Inst::Invalidate() {
+    ClearArgs();
+    op = Opcode::Void;
+}
+
+void Inst::ClearArgs() {
+    for (auto& value : args) {
+        if (!value.IsImmediate()) {
+            UndoUse(value);
+        }
+        value = {};
+    }
+}
+
+void Inst::ReplaceUsesWith(Value replacement) {
+    Invalidate();
+
+    op = Opcode::Identity;
+
+    if (!replacement.IsImmediate()) {
+        Use(replacement);
+    }
+
+    args[0] = replacement;
+}
+
+void Inst::Use(const Value& value) {
+    value.GetInst()->use_count++;
+}
+
+void Inst::UndoUse(const Value& value) {
+    value.GetInst()->use_count--;
+}
+
+} // namespace Teakra::IR
@@ -3,8 +3,8 @@
 #include <array>
 
 #include <mcl/container/intrusive_list.hpp>
-#include <mcl/stdint.hpp>
 
+#include "common_types.h"
 #include "ir/value.h"
 
 namespace Teakra::IR {
@@ -22,21 +22,61 @@ class Inst final : public mcl::intrusive_list_node<Inst> {
 public:
     explicit Inst(Opcode op) : op(op) {}
 
+    /// Determines whether or not this instruction reads from or writes to a DSP register.
+    bool AccessesRegister() const;
+    /// Determines whether or not this instruction accesses data memory (including MMIO).
+    bool AccessesMemory() const;
+    /// Determines whether or not this instruction writes the accumulator status flags.
+    bool WritesToFlags() const;
+
+    /// Determines whether or not this instruction may have side-effects.
+    bool MayHaveSideEffects() const;
+
+    /// Determines if all arguments of this instruction are immediates.
+    bool AreAllArgsImmediates() const;
+
+    size_t UseCount() const {
+        return use_count;
+    }
+    bool HasUses() const {
+        return use_count > 0;
+    }
+
     /// Get the microop this microinstruction represents.
     Opcode GetOpcode() const {
         return op;
     }
+    /// Get the type this instruction returns.
+    Type GetType() const;
     /// Get the number of arguments this instruction has.
     size_t NumArgs() const;
 
+    Value GetArg(size_t index) const;
+    void SetArg(size_t index, Value value);
+
+    void Invalidate();
+    void ClearArgs();
+
+    /// Turns this instruction into an Identity of replacement, redirecting all its uses.
+    void ReplaceUsesWith(Value replacement);
+
+    // IR name (i.e. instruction number in block). This is set in the naming pass. Treat 0 as an
+    // invalid name. This is used for debugging and register allocation.
+    void SetName(u32 value) {
+        name = value;
+    }
+    u32 GetName() const {
+        return name;
+    }
+
 private:
+    void Use(const Value& value);
+    void UndoUse(const Value& value);
+
     Opcode op;
     u32 use_count = 0;
     u32 name = 0;
     std::array<Value, max_arg_count> args;
-
-    // Linked list of pseudooperations associated with this instruction.
-    Inst* next_pseudoop = nullptr;
 };
 
 } // namespace Teakra::IR
@@ -0,0 +1,49 @@
+#include <array>
+#include <vector>
+
+#include "ir/opcode.h"
+#include "ir/value.h"
+
+namespace Teakra::IR {
+
+namespace {
+
+struct Meta {
+    const char* name;
+    Type type;
+    std::vector<Type> arg_types;
+};
+
+constexpr Type Void = Type::Void;
+constexpr Type Opaque = Type::Opaque;
+constexpr Type Reg = Type::Reg;
+constexpr Type U1 = Type::U1;
+constexpr Type U8 = Type::U8;
+constexpr Type U16 = Type::U16;
+constexpr Type U64 = Type::U64;
+
+const std::array<Meta, OpcodeCount> opcode_info{{
+#define OPCODE(name, type, ...) Meta{#name, type, {__VA_ARGS__}},
+#include "opcode.inc"
+#undef OPCODE
+}};
+
+} // Anonymous namespace
+
+Type GetTypeOf(Opcode op) {
+    return opcode_info.at(static_cast<size_t>(op)).type;
+}
+
+size_t GetNumArgsOf(Opcode op) {
+    return opcode_info.at(static_cast<size_t>(op)).arg_types.size();
+}
+
+Type GetArgTypeOf(Opcode op, size_t arg_index) {
+    return opcode_info.at(static_cast<size_t>(op)).arg_types.at(arg_index);
+}
+
+const char* GetNameOf(Opcode op) {
+    return opcode_info.at(static_cast<size_t>(op)).name;
+}
+
+} // namespace Teakra::IR
@@ -1,31 +1,34 @@
 #pragma once
 
+#include <cstddef>
+
 namespace Teakra::IR {
 
+enum class Type;
+
+/**
+ * The Opcodes of our intermediate representation.
+ * Type signatures for each opcode can be found in opcode.inc
+ */
 enum class Opcode {
-    GetRegister16, // U16, RegName
-    GetRegister32, // U32, RegName
-    GetAcc,        // U64, RegName
-    GetXFactor,    // U32,
-    GetYFactor,
-    SetRegister16,       // Void, RegName, U16
-    SetAcc,              // Void, RegName, U64
-    SetProduct,          // Void, U32, U32
-    SetAccFlag,          //
-    SignExtend32,        // U32, U32, U8
-    SaturateAcc,         // U64, U64, U1
-    LogicalShiftLeft32,  // U32, U32, U8
-    LogicalShiftRight32, // U32, U32, U8
-    Add16,               // U16, U16, U16
-    Sub16,               // U16, U16, U16
-    Mul32,               // U32, U32, U32
-    And32,               // U32, U32, U32
-    TestBit,             // U1, U32, U8
-    ExtractHalf32,       // U16, U32, U8
-    ExtractHalf64,       // U16, U64, U8
-    ReadMemory16,        // U16, U16
-    WriteMemory16,       // Void, U16, U16
-    Pack2x16To1x32       // U32, U16, U16
+#define OPCODE(name, type, ...) name,
+#include "opcode.inc"
+#undef OPCODE
+    NUM_OPCODE
 };
 
+constexpr size_t OpcodeCount = static_cast<size_t>(Opcode::NUM_OPCODE);
+
+/// Get return type of an opcode
+Type GetTypeOf(Opcode op);
+
+/// Get the number of arguments an opcode accepts
+size_t GetNumArgsOf(Opcode op);
+
+/// Get the required type of an argument of an opcode
+Type GetArgTypeOf(Opcode op, size_t arg_index);
+
+/// Get the name of an opcode.
+const char* GetNameOf(Opcode op);
+
 } // namespace Teakra::IR
@@ -0,0 +1,143 @@
+#include "common_types.h"
+#include "ir/basic_block.h"
+#include "ir/opcode.h"
+#include "ir/opt/passes.h"
+#include "ir/value.h"
+
+namespace Teakra::Optimization {
+
+namespace {
+
+// Folds a bitwise operation where one argument is an immediate that makes the result trivial.
+void FoldIdentityBitwise(IR::Inst& inst, bool is_and) {
+    const IR::Value lhs = inst.GetArg(0);
+    const IR::Value rhs = inst.GetArg(1);
+
+    if (lhs.IsImmediate() && rhs.IsImmediate()) {
+        const u64 a = lhs.GetU64();
+        const u64 b = rhs.GetU64();
+        u64 result;
+        switch (inst.GetOpcode()) {
+        case IR::Opcode::And64:
+            result = a & b;
+            break;
+        case IR::Opcode::Or64:
+            result = a | b;
+            break;
+        case IR::Opcode::Xor64:
+            result = a ^ b;
+            break;
+        default:
+            UNREACHABLE();
+        }
+        inst.ReplaceUsesWith(IR::Value{result});
+        return;
+    }
+
+    // Canonicalize the immediate to the right hand side
+    const IR::Value value = lhs.IsImmediate() ? rhs : lhs;
+    const IR::Value imm = lhs.IsImmediate() ? lhs : rhs;
+    if (!imm.IsImmediate()) {
+        return;
+    }
+
+    if (is_and) {
+        if (imm.IsZero()) {
+            inst.ReplaceUsesWith(IR::Value{u64{0}});
+        } else if (imm.HasAllBitsSet()) {
+            inst.ReplaceUsesWith(value);
+        }
+    } else if (imm.IsZero()) {
+        inst.ReplaceUsesWith(value);
+    }
+}
+
+void FoldSaturateAcc(IR::Inst& inst) {
+    const IR::Value value = inst.GetArg(0);
+    if (!value.IsImmediate()) {
+        return;
+    }
+
+    const u64 acc = value.GetU64();
+    if (acc == SignExtend<32>(acc)) {
+        // Saturation neither changes the value nor raises flm
+        inst.ReplaceUsesWith(value);
+        return;
+    }
+
+    // The result is known, but flm still has to be raised at run time
+    if (!inst.GetArg(1).GetU1()) {
+        const u64 saturated = (acc >> 39) != 0 ? 0xFFFF'FFFF'8000'0000 : 0x0000'0000'7FFF'FFFF;
+        inst.ReplaceUsesWith(IR::Value{saturated});
+    }
+}
+
+} // Anonymous namespace
+
+void ConstantFolding(IR::Block& block) {
+    for (IR::Inst& inst : block) {
+        const IR::Opcode opcode = inst.GetOpcode();
+
+        switch (opcode) {
+        case IR::Opcode::And64:
+            FoldIdentityBitwise(inst, true);
+            break;
+        case IR::Opcode::Or64:
+        case IR::Opcode::Xor64:
+            FoldIdentityBitwise(inst, false);
+            break;
+        case IR::Opcode::SaturateAcc:
+            FoldSaturateAcc(inst);
+            break;
+        case IR::Opcode::SignExtend64:
+            if (inst.AreAllArgsImmediates()) {
+                const u64 value = inst.GetArg(0).GetU64();
+                const u8 bits = inst.GetArg(1).GetU8();
+                inst.ReplaceUsesWith(IR::Value{SignExtend(value, bits)});
+            }
+            break;
+        case IR::Opcode::ZeroExtend16To64:
+            if (inst.AreAllArgsImmediates()) {
+                inst.ReplaceUsesWith(IR::Value{u64{inst.GetArg(0).GetU16()}});
+            }
+            break;
+        case IR::Opcode::LogicalShiftLeft64:
+        case IR::Opcode::LogicalShiftRight64:
+            if (inst.GetArg(1).IsZero()) {
+                inst.ReplaceUsesWith(inst.GetArg(0));
+            } else if (inst.AreAllArgsImmediates()) {
+                const u64 value = inst.GetArg(0).GetU64();
+                const u8 shift = inst.GetArg(1).GetU8();
+                u64 result = 0;
+                if (shift < 64) {
+                    result = opcode == IR::Opcode::LogicalShiftLeft64 ? value << shift
+                                                                      : value >> shift;
+                }
+                inst.ReplaceUsesWith(IR::Value{result});
+            }
+            break;
+        case IR::Opcode::ExtractHalf64:
+            if (inst.AreAllArgsImmediates()) {
+                const u64 value = inst.GetArg(0).GetU64();
+                const u8 half = inst.GetArg(1).GetU8();
+                inst.ReplaceUsesWith(IR::Value{static_cast<u16>(value >> (16 * half))});
+            }
+            break;
+        case IR::Opcode::Add16:
+        case IR::Opcode::Sub16:
+            if (inst.GetArg(1).IsZero()) {
+                inst.ReplaceUsesWith(inst.GetArg(0));
+            } else if (inst.AreAllArgsImmediates()) {
+                const u16 a = inst.GetArg(0).GetU16();
+                const u16 b = inst.GetArg(1).GetU16();
+                const u16 result = static_cast<u16>(opcode == IR::Opcode::Add16 ? a + b : a - b);
+                inst.ReplaceUsesWith(IR::Value{result});
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+} // namespace Teakra::Optimization
@@ -0,0 +1,16 @@
+#include "ir/basic_block.h"
+#include "ir/opt/passes.h"
+
+namespace Teakra::Optimization {
+
+void DeadCodeElimination(IR::Block& block) {
+    // We iterate over the instructions in reverse order.
+    // This is because removing an instruction reduces the number of uses for earlier instructions.
+    for (auto iter = block.rbegin(); iter != block.rend(); ++iter) {
+        if (!iter->HasUses() && !iter->MayHaveSideEffects()) {
+            iter->Invalidate();
+        }
+    }
+}
+
+} // namespace Teakra::Optimization
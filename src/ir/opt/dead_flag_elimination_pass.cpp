@@ -0,0 +1,23 @@
+#include "ir/basic_block.h"
+#include "ir/opcode.h"
+#include "ir/opt/passes.h"
+
+namespace Teakra::Optimization {
+
+void DeadFlagElimination(IR::Block& block) {
+    // No IR instruction reads fz/fm/fe/fn, so within a block only the last update of them is
+    // observable. It stays live since the code following the block may read it.
+    bool flags_live = true;
+    for (auto iter = block.rbegin(); iter != block.rend(); ++iter) {
+        if (iter->GetOpcode() != IR::Opcode::SetAccFlag) {
+            continue;
+        }
+        if (flags_live) {
+            flags_live = false;
+        } else {
+            iter->Invalidate();
+        }
+    }
+}
+
+} // namespace Teakra::Optimization
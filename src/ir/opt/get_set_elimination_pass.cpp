@@ -0,0 +1,51 @@
+#include <unordered_map>
+
+#include "ir/basic_block.h"
+#include "ir/opcode.h"
+#include "ir/opt/passes.h"
+#include "ir/value.h"
+#include "operand.h"
+
+namespace Teakra::Optimization {
+
+void GetSetElimination(IR::Block& block) {
+    struct RegisterInfo {
+        IR::Value register_value;
+        IR::Inst* last_set_instruction = nullptr;
+    };
+    // Accumulators are always accessed as a whole and 16-bit registers never alias each other,
+    // so one entry per register name is enough.
+    std::unordered_map<RegName, RegisterInfo> register_info;
+
+    const auto do_set = [&](RegisterInfo& info, IR::Value value, IR::Inst* set_inst) {
+        if (info.last_set_instruction) {
+            info.last_set_instruction->Invalidate();
+        }
+        info = {value, set_inst};
+    };
+
+    const auto do_get = [](RegisterInfo& info, IR::Inst* get_inst) {
+        if (info.register_value.IsEmpty()) {
+            info.register_value = IR::Value(get_inst);
+            return;
+        }
+        get_inst->ReplaceUsesWith(info.register_value);
+    };
+
+    for (IR::Inst& inst : block) {
+        switch (inst.GetOpcode()) {
+        case IR::Opcode::GetRegister16:
+        case IR::Opcode::GetAcc:
+            do_get(register_info[inst.GetArg(0).GetRegName()], &inst);
+            break;
+        case IR::Opcode::SetRegister16:
+        case IR::Opcode::SetAcc:
+            do_set(register_info[inst.GetArg(0).GetRegName()], inst.GetArg(1), &inst);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+} // namespace Teakra::Optimization
@@ -0,0 +1,47 @@
+#include <vector>
+
+#include "ir/basic_block.h"
+#include "ir/opcode.h"
+#include "ir/opt/passes.h"
+
+namespace Teakra::Optimization {
+
+void IdentityRemoval(IR::Block& block) {
+    std::vector<IR::Inst*> to_invalidate;
+
+    auto iter = block.begin();
+    while (iter != block.end()) {
+        IR::Inst& inst = *iter;
+
+        const size_t num_args = inst.NumArgs();
+        for (size_t i = 0; i < num_args; i++) {
+            while (true) {
+                IR::Value arg = inst.GetArg(i);
+                if (!arg.IsIdentity()) {
+                    break;
+                }
+                inst.SetArg(i, arg.GetInst()->GetArg(0));
+            }
+        }
+
+        if (inst.GetOpcode() == IR::Opcode::Identity || inst.GetOpcode() == IR::Opcode::Void) {
+            to_invalidate.push_back(&inst);
+            iter = block.Instructions().erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    for (IR::Inst* inst : to_invalidate) {
+        inst->Invalidate();
+    }
+}
+
+void NamingPass(IR::Block& block) {
+    u32 name = 1;
+    for (auto& inst : block) {
+        inst.SetName(name++);
+    }
+}
+
+} // namespace Teakra::Optimization
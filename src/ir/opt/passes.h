@@ -0,0 +1,24 @@
+#pragma once
+
+namespace Teakra::IR {
+class Block;
+}
+
+namespace Teakra::Optimization {
+
+/// Forwards register values within a block and drops stores that are overwritten before any read.
+void GetSetElimination(IR::Block& block);
+/// Removes accumulator flag updates that are overwritten later in the block.
+void DeadFlagElimination(IR::Block& block);
+/// Evaluates instructions whose arguments are all known at compile time.
+void ConstantFolding(IR::Block& block);
+/// Removes instructions that have no uses and no side effects.
+void DeadCodeElimination(IR::Block& block);
+/// Redirects uses of Identity instructions to their argument and unlinks them from the block.
+void IdentityRemoval(IR::Block& block);
+/// Numbers the instructions of a block starting from 1, for dumps and value slots.
+void NamingPass(IR::Block& block);
+/// Checks argument types and use counts. Asserts on failure.
+void VerificationPass(const IR::Block& block);
+
+} // namespace Teakra::Optimization
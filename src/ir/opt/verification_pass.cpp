@@ -0,0 +1,38 @@
+#include <unordered_map>
+
+#include "crash.h"
+#include "ir/basic_block.h"
+#include "ir/opcode.h"
+#include "ir/opt/passes.h"
+#include "ir/value.h"
+
+namespace Teakra::Optimization {
+
+void VerificationPass(const IR::Block& block) {
+    for (const auto& inst : block) {
+        for (size_t i = 0; i < inst.NumArgs(); i++) {
+            const IR::Type t1 = inst.GetArg(i).GetType();
+            const IR::Type t2 = IR::GetArgTypeOf(inst.GetOpcode(), i);
+            if (!IR::AreTypesCompatible(t1, t2)) {
+                std::fprintf(stderr, "%s\n", IR::DumpBlock(block).c_str());
+                UNREACHABLE();
+            }
+        }
+    }
+
+    std::unordered_map<const IR::Inst*, size_t> actual_uses;
+    for (const auto& inst : block) {
+        for (size_t i = 0; i < inst.NumArgs(); i++) {
+            const auto arg = inst.GetArg(i);
+            if (!arg.IsImmediate()) {
+                actual_uses[arg.GetInst()]++;
+            }
+        }
+    }
+
+    for (const auto& [inst, uses] : actual_uses) {
+        ASSERT(inst->UseCount() == uses);
+    }
+}
+
+} // namespace Teakra::Optimization
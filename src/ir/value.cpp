@@ -0,0 +1,181 @@
+#include "ir/value.h"
+#include "ir/microinstruction.h"
+#include "ir/opcode.h"
+
+namespace Teakra::IR {
+
+const char* GetNameOf(Type type) {
+    switch (type) {
+    case Type::Void:
+        return "Void";
+    case Type::Opaque:
+        return "Opaque";
+    case Type::Reg:
+        return "Reg";
+    case Type::U1:
+        return "U1";
+    case Type::U8:
+        return "U8";
+    case Type::U16:
+        return "U16";
+    case Type::S16:
+        return "S16";
+    case Type::U32:
+        return "U32";
+    case Type::U64:
+        return "U64";
+    default:
+        return "<multiple types>";
+    }
+}
+
+bool AreTypesCompatible(Type t1, Type t2) {
+    return t1 == t2 || t1 == Type::Opaque || t2 == Type::Opaque;
+}
+
+bool Value::IsIdentity() const {
+    if (type == Type::Opaque) {
+        return inner.inst->GetOpcode() == Opcode::Identity;
+    }
+    return false;
+}
+
+bool Value::IsEmpty() const {
+    return type == Type::Void;
+}
+
+bool Value::IsImmediate() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).IsImmediate();
+    }
+    return type != Type::Opaque;
+}
+
+Type Value::GetType() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetType();
+    }
+    if (type == Type::Opaque) {
+        return inner.inst->GetType();
+    }
+    return type;
+}
+
+Inst* Value::GetInst() const {
+    ASSERT(type == Type::Opaque);
+    return inner.inst;
+}
+
+Inst* Value::GetInstRecursive() const {
+    ASSERT(type == Type::Opaque);
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetInstRecursive();
+    }
+    return inner.inst;
+}
+
+RegName Value::GetRegName() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetRegName();
+    }
+    ASSERT(type == Type::Reg);
+    return inner.reg;
+}
+
+bool Value::GetU1() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetU1();
+    }
+    ASSERT(type == Type::U1);
+    return inner.imm_u1;
+}
+
+u8 Value::GetU8() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetU8();
+    }
+    ASSERT(type == Type::U8);
+    return inner.imm_u8;
+}
+
+u16 Value::GetU16() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetU16();
+    }
+    ASSERT(type == Type::U16);
+    return inner.imm_u16;
+}
+
+s16 Value::GetS16() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetS16();
+    }
+    ASSERT(type == Type::S16);
+    return inner.imm_s16;
+}
+
+u32 Value::GetU32() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetU32();
+    }
+    ASSERT(type == Type::U32);
+    return inner.imm_u32;
+}
+
+u64 Value::GetU64() const {
+    if (IsIdentity()) {
+        return inner.inst->GetArg(0).GetU64();
+    }
+    ASSERT(type == Type::U64);
+    return inner.imm_u64;
+}
+
+u64 Value::GetImmediateAsU64() const {
+    ASSERT(IsImmediate());
+
+    switch (GetType()) {
+    case Type::U1:
+        return GetU1();
+    case Type::U8:
+        return GetU8();
+    case Type::U16:
+        return GetU16();
+    case Type::S16:
+        return static_cast<u16>(GetS16());
+    case Type::U32:
+        return GetU32();
+    case Type::U64:
+        return GetU64();
+    default:
+        UNREACHABLE();
+    }
+}
+
+bool Value::HasAllBitsSet() const {
+    if (!IsImmediate()) {
+        return false;
+    }
+
+    switch (GetType()) {
+    case Type::U1:
+        return GetU1();
+    case Type::U8:
+        return GetU8() == 0xFF;
+    case Type::U16:
+        return GetU16() == 0xFFFF;
+    case Type::S16:
+        return GetS16() == -1;
+    case Type::U32:
+        return GetU32() == 0xFFFF'FFFF;
+    case Type::U64:
+        return GetU64() == 0xFFFF'FFFF'FFFF'FFFF;
+    default:
+        return false;
+    }
+}
+
+bool Value::IsZero() const {
+    return IsImmediate() && GetType() != Type::Reg && GetImmediateAsU64() == 0;
+}
+
+} // namespace Teakra::IR
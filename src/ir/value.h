@@ -13,6 +13,7 @@ class Inst;
 
 /**
  * The intermediate representation is typed. These are the used by our IR.
+ * Opaque is the type of a value referring to an instruction whose result type is not known yet.
  */
 enum class Type {
     Void = 0,
@@ -34,6 +35,12 @@ constexpr Type operator&(Type a, Type b) {
     return static_cast<Type>(static_cast<size_t>(a) & static_cast<size_t>(b));
 }
 
+/// Returns the name of a type, for debugging.
+const char* GetNameOf(Type type);
+
+/// Checks whether a value of type t1 may be used where a value of type t2 is expected.
+bool AreTypesCompatible(Type t1, Type t2);
+
 /**
  * A representation of a value in the IR.
  * A value may either be an immediate or the result of a microinstruction.
@@ -68,25 +75,27 @@ public:
         inner.imm_u64 = imm;
     }
 
-    Type GetType() const {
-        return type;
-    }
-
-    RegName GetRegName() const {
-        return inner.reg;
-    }
-
-    bool GetU1() const {
-        return inner.imm_u1;
-    }
-
-    u16 GetU16() const {
-        return inner.imm_u16;
-    }
-
-    s16 GetS16() const {
-        return inner.imm_s16;
-    }
+    bool IsIdentity() const;
+    bool IsEmpty() const;
+    bool IsImmediate() const;
+    Type GetType() const;
+
+    Inst* GetInst() const;
+    Inst* GetInstRecursive() const;
+
+    RegName GetRegName() const;
+    bool GetU1() const;
+    u8 GetU8() const;
+    u16 GetU16() const;
+    s16 GetS16() const;
+    u32 GetU32() const;
+    u64 GetU64() const;
+
+    /// Zero-extends an immediate of any integral type to 64 bits.
+    u64 GetImmediateAsU64() const;
+    /// Immediate tests used by the constant folder, false for non-immediates.
+    bool HasAllBitsSet() const;
+    bool IsZero() const;
 
 private:
     Type type;
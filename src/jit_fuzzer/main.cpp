@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <teakra/disassembler.h>
+#include <teakra/teakra.h>
+#include "../interpreter.h"
+#include "../jit_regs.h"
+#include "../processor.h"
+#include "../register.h"
+#include "../test.h"
+
+namespace {
+
+constexpr u32 DataOffset = 0x40000; // byte offset of data memory in the DSP memory image
+constexpr u32 RunCycles = 0x40000;  // more than any generated program can take to finish
+
+constexpr u16 IdleLoop = 0x57F0; // brr 0xffff always
+constexpr u16 RepOpcode = 0x0C00;
+constexpr u16 BkrepOpcode = 0x5C00;
+
+// Instruction families drawn from. Control flow, interrupts, program memory access, the stack
+// pointer and loop counters are left out so that every program runs into the idle loop at its
+// end within RunCycles.
+const char* const Mnemonics[] = {
+    "mov", "movs", "movsi", "or", "and", "xor", "add", "sub", "cmp", "cmpu", "addl", "addh", "subl",
+    "subh", "addv", "subv", "cmpv", "set", "rst", "chng", "tst0", "tst1", "shfi", "shfc", "shr",
+    "shr4", "shl", "shl4", "ror", "rol", "not", "neg", "rnd", "inc", "dec", "copy", "swap", "clr",
+    "lim", "pacr", "mac", "msu", "macsu", "macus", "macuu", "mpy", "mpysu", "mpyi", "maa", "maasu",
+    "sqr", "sqra", "modr", "exchange", "banke", "push", "pop", "load", "max", "min",
+};
+
+const char* const ExcludedOperands[] = {
+    "pc", "prpage", "page", "sp", "lc", "repc", "icr", "stt2", "ext0", "ext1", "ext2", "ext3",
+};
+
+// Deterministic byte stream: the fuzzer input under libFuzzer, a seeded PRNG otherwise
+class Source {
+public:
+    explicit Source(std::span<const u8> data) : data(data) {}
+
+    u32 Next(u32 bound) {
+        u32 value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value = (value << 8) | (pos < data.size() ? data[pos++] : 0);
+        }
+        return bound == 0 ? value : value % bound;
+    }
+
+private:
+    std::span<const u8> data;
+    std::size_t pos = 0;
+};
+
+std::vector<u16> CandidateOpcodes() {
+    std::vector<u16> candidates;
+    for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
+        const auto tokens = Teakra::Disassembler::GetTokenList(static_cast<u16>(opcode));
+        const auto has = [&tokens](const char* name) {
+            return std::find(tokens.begin(), tokens.end(), name) != tokens.end();
+        };
+        if (std::none_of(std::begin(Mnemonics), std::end(Mnemonics),
+                         [&](const char* m) { return tokens.front() == m; }) ||
+            std::any_of(std::begin(ExcludedOperands), std::end(ExcludedOperands), has) ||
+            std::any_of(tokens.begin(), tokens.end(), [](const std::string& token) {
+                return token.find("[ERROR]") != std::string::npos;
+            })) {
+            continue;
+        }
+        candidates.push_back(static_cast<u16>(opcode));
+    }
+    return candidates;
+}
+
+void WriteProgram(Teakra::Teakra& teakra, const std::vector<u16>& program) {
+    std::memcpy(teakra.GetDspMemory().data(), program.data(), program.size() * sizeof(u16));
+}
+
+// The JIT aborts on instructions it doesn't implement, so compile each candidate in a child
+// process and keep the ones that compile. The child announces every opcode before compiling it,
+// which tells the parent where to resume after a crash.
+std::vector<u16> ProbeJit(const std::vector<u16>& candidates) {
+    std::vector<u16> supported;
+    std::size_t next = 0;
+    while (next < candidates.size()) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::perror("pipe");
+            std::exit(-1);
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            std::freopen("/dev/null", "w", stderr);
+            Teakra::Teakra teakra(true);
+            for (std::size_t i = next; i < candidates.size(); ++i) {
+                if (write(fds[1], &i, sizeof(i)) != sizeof(i)) {
+                    _exit(-1);
+                }
+                teakra.Reset();
+                WriteProgram(teakra, {candidates[i], 0, IdleLoop});
+                teakra.Precompile(0);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+
+        std::size_t index;
+        std::size_t last = 0;
+        bool announced = false;
+        while (read(fds[0], &index, sizeof(index)) == sizeof(index)) {
+            if (announced) {
+                supported.push_back(candidates[last]);
+            }
+            last = index;
+            announced = true;
+        }
+        close(fds[0]);
+        int status;
+        waitpid(pid, &status, 0);
+        if (!announced) {
+            ++next;
+            continue;
+        }
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            supported.push_back(candidates[last]);
+        }
+        next = last + 1;
+    }
+    return supported;
+}
+
+struct Case {
+    State state;
+    std::vector<u16> program;
+};
+
+u16 TestAddress(Source& source) {
+    return static_cast<u16>((source.Next(2) ? TestSpaceX : TestSpaceY) +
+                            source.Next(TestSpaceSize));
+}
+
+class Generator {
+public:
+    explicit Generator(std::vector<u16> pool) : pool(std::move(pool)) {}
+
+    Case Generate(Source& source) const {
+        Case c{};
+        EmitSequence(source, c.program, 1 + source.Next(24), 0);
+        c.program.push_back(IdleLoop);
+
+        State& s = c.state;
+        for (int i = 0; i < 2; ++i) {
+            s.a[i] = SignExtend<40>((u64)source.Next(0) << 32 | source.Next(0));
+            s.b[i] = SignExtend<40>((u64)source.Next(0) << 32 | source.Next(0));
+            s.p[i] = source.Next(0);
+            s.x[i] = static_cast<u16>(source.Next(0x10000));
+            s.y[i] = static_cast<u16>(source.Next(0x10000));
+        }
+        // Keep the address registers and steps near the test spaces, away from MMIO
+        for (auto& r : s.r) {
+            r = TestAddress(source);
+        }
+        s.stepi0 = static_cast<u16>(source.Next(17) - 8);
+        s.stepj0 = static_cast<u16>(source.Next(17) - 8);
+        s.cfgi = static_cast<u16>(source.Next(0x200) << 7 | ((source.Next(17) - 8) & 0x7F));
+        s.cfgj = static_cast<u16>(source.Next(0x200) << 7 | ((source.Next(17) - 8) & 0x7F));
+        s.mixp = static_cast<u16>(source.Next(0x10000));
+        s.sv = static_cast<u16>(source.Next(33) - 16);
+        s.stt0 = static_cast<u16>(source.Next(0x10000));
+        for (u16 i = 0; i < TestSpaceSize; ++i) {
+            s.test_space_x[i] = static_cast<u16>(source.Next(0x10000));
+            s.test_space_y[i] = static_cast<u16>(source.Next(0x10000));
+        }
+
+        return c;
+    }
+
+private:
+    void EmitPlain(Source& source, std::vector<u16>& program) const {
+        const u16 opcode = pool[source.Next(static_cast<u32>(pool.size()))];
+        program.push_back(opcode);
+        if (Teakra::Disassembler::NeedExpansion(opcode)) {
+            const auto tokens = Teakra::Disassembler::GetTokenList(opcode, 0);
+            const bool address = std::any_of(tokens.begin(), tokens.end(), [](const auto& t) {
+                return t.starts_with("[0x");
+            });
+            program.push_back(address ? TestAddress(source)
+                                      : static_cast<u16>(source.Next(0x10000)));
+        }
+    }
+
+    void EmitSequence(Source& source, std::vector<u16>& program, u32 length, u32 depth) const {
+        for (u32 i = 0; i < length; ++i) {
+            const u32 kind = source.Next(16);
+            if (kind == 0) {
+                program.push_back(static_cast<u16>(RepOpcode | source.Next(8)));
+                EmitPlain(source, program);
+            } else if (kind == 1 && depth < 2) {
+                program.push_back(static_cast<u16>(BkrepOpcode | source.Next(4)));
+                const std::size_t end_slot = program.size();
+                program.push_back(0);
+                EmitSequence(source, program, source.Next(6), depth + 1);
+                // The loop end is the address of the last instruction in the body
+                const std::size_t last = program.size();
+                EmitPlain(source, program);
+                program[end_slot] = static_cast<u16>(last);
+            } else {
+                EmitPlain(source, program);
+            }
+        }
+    }
+
+    std::vector<u16> pool;
+};
+
+void SetState(Teakra::RegisterState& regs, const State& s) {
+    regs.a = s.a;
+    regs.b = s.b;
+    regs.p = s.p;
+    regs.r = s.r;
+    regs.x = s.x;
+    regs.y = s.y;
+    regs.stepi0 = s.stepi0;
+    regs.stepj0 = s.stepj0;
+    regs.mixp = s.mixp;
+    regs.sv = s.sv;
+    regs.sp = TestSpaceY + TestSpaceSize / 2;
+    regs.page = TestSpaceX >> 8;
+    regs.Set<Teakra::cfgi>(s.cfgi);
+    regs.Set<Teakra::cfgj>(s.cfgj);
+    regs.Set<Teakra::stt0>(s.stt0);
+}
+
+void SetState(Teakra::JitRegisters& regs, const State& s) {
+    regs.a = s.a;
+    regs.b = s.b;
+    regs.p = s.p;
+    regs.r = s.r;
+    regs.x = s.x;
+    regs.y = s.y;
+    regs.stepi0 = s.stepi0;
+    regs.stepj0 = s.stepj0;
+    regs.mixp = s.mixp;
+    regs.sv = s.sv;
+    regs.sp = TestSpaceY + TestSpaceSize / 2;
+    regs.mod1.page.Assign(TestSpaceX >> 8);
+    regs.cfgi.raw = s.cfgi;
+    regs.cfgj.raw = s.cfgj;
+    regs.flags.raw = static_cast<u16>((s.stt0 & Teakra::Stt0::Mask()) << 1);
+}
+
+// The registers compared after a run, named for the report
+struct Snapshot {
+    std::vector<std::pair<const char*, u64>> values;
+
+    void Add(const char* name, u64 value) {
+        values.emplace_back(name, value);
+    }
+};
+
+Snapshot TakeSnapshot(Teakra::RegisterState& regs) {
+    Snapshot s;
+    s.Add("pc", regs.pc);
+    s.Add("a0", regs.a[0]);
+    s.Add("a1", regs.a[1]);
+    s.Add("b0", regs.b[0]);
+    s.Add("b1", regs.b[1]);
+    s.Add("p0", regs.p[0]);
+    s.Add("p1", regs.p[1]);
+    for (std::size_t i = 0; i < 8; ++i) {
+        static const char* const names[] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"};
+        s.Add(names[i], regs.r[i]);
+    }
+    s.Add("x0", regs.x[0]);
+    s.Add("x1", regs.x[1]);
+    s.Add("y0", regs.y[0]);
+    s.Add("y1", regs.y[1]);
+    s.Add("stepi0", regs.stepi0);
+    s.Add("stepj0", regs.stepj0);
+    s.Add("mixp", regs.mixp);
+    s.Add("sv", regs.sv);
+    s.Add("sp", regs.sp);
+    s.Add("repc", regs.repc);
+    s.Add("lc", regs.Lc());
+    s.Add("cfgi", regs.Get<Teakra::cfgi>());
+    s.Add("cfgj", regs.Get<Teakra::cfgj>());
+    s.Add("stt0", regs.Get<Teakra::stt0>());
+    return s;
+}
+
+Snapshot TakeSnapshot(Teakra::JitRegisters& regs) {
+    Snapshot s;
+    s.Add("pc", regs.pc);
+    s.Add("a0", regs.a[0]);
+    s.Add("a1", regs.a[1]);
+    s.Add("b0", regs.b[0]);
+    s.Add("b1", regs.b[1]);
+    s.Add("p0", regs.p[0]);
+    s.Add("p1", regs.p[1]);
+    for (std::size_t i = 0; i < 8; ++i) {
+        static const char* const names[] = {"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"};
+        s.Add(names[i], regs.r[i]);
+    }
+    s.Add("x0", regs.x[0]);
+    s.Add("x1", regs.x[1]);
+    s.Add("y0", regs.y[0]);
+    s.Add("y1", regs.y[1]);
+    s.Add("stepi0", regs.stepi0);
+    s.Add("stepj0", regs.stepj0);
+    s.Add("mixp", regs.mixp);
+    s.Add("sv", regs.sv);
+    s.Add("sp", regs.sp);
+    s.Add("repc", regs.repc);
+    s.Add("lc", regs.lp ? regs.bkrep_stack[regs.bcn - 1].lc : regs.bkrep_stack[0].lc);
+    s.Add("cfgi", regs.cfgi.raw);
+    s.Add("cfgj", regs.cfgj.raw);
+    s.Add("stt0", (regs.flags.raw >> 1) & Teakra::Stt0::Mask());
+    return s;
+}
+
+class Fuzzer {
+public:
+    explicit Fuzzer(std::vector<u16> pool) : generator(std::move(pool)) {
+        for (auto* teakra : {&interp, &jit}) {
+            teakra->SetAudioCallback([](std::array<s16, 2>) {});
+            Teakra::AHBMCallback ahbm;
+            ahbm.read8 = [](u32) -> u8 { return 0; };
+            ahbm.write8 = [](u32, u8) {};
+            ahbm.read16 = [](u32) -> u16 { return 0; };
+            ahbm.write16 = [](u32, u16) {};
+            ahbm.read32 = [](u32) -> u32 { return 0; };
+            ahbm.write32 = [](u32, u32) {};
+            teakra->SetAHBMCallback(ahbm);
+        }
+    }
+
+    // Returns false and prints the case if the engines disagree
+    bool RunCase(Source& source) {
+        const Case c = generator.Generate(source);
+        for (auto* teakra : {&interp, &jit}) {
+            teakra->Reset();
+            WriteProgram(*teakra, c.program);
+            auto& memory = teakra->GetDspMemory();
+            for (u16 i = 0; i < TestSpaceSize; ++i) {
+                std::memcpy(&memory[DataOffset + (TestSpaceX + i) * 2], &c.state.test_space_x[i],
+                            sizeof(u16));
+                std::memcpy(&memory[DataOffset + (TestSpaceY + i) * 2], &c.state.test_space_y[i],
+                            sizeof(u16));
+            }
+        }
+        SetState(interp.GetProcessor().InterpRegs(), c.state);
+        SetState(jit.GetProcessor().JitRegs(), c.state);
+
+        try {
+            interp.Run(RunCycles);
+        } catch (const Teakra::UnimplementedException&) {
+            ++skipped;
+            return true;
+        }
+        jit.Run(RunCycles);
+
+        const auto expected = TakeSnapshot(interp.GetProcessor().InterpRegs());
+        const auto actual = TakeSnapshot(jit.GetProcessor().JitRegs());
+        bool pass = true;
+        for (std::size_t i = 0; i < expected.values.size(); ++i) {
+            if (expected.values[i].second != actual.values[i].second) {
+                if (pass) {
+                    Print(c);
+                }
+                std::printf("Mismatch: %s: %010" PRIx64 " != %010" PRIx64 "\n",
+                            expected.values[i].first, expected.values[i].second & 0xFF'FFFF'FFFF,
+                            actual.values[i].second & 0xFF'FFFF'FFFF);
+                pass = false;
+            }
+        }
+        const auto& expected_memory = interp.GetDspMemory();
+        const auto& actual_memory = jit.GetDspMemory();
+        for (u32 address = 0; address < 0x10000; ++address) {
+            u16 expected_word, actual_word;
+            std::memcpy(&expected_word, &expected_memory[DataOffset + address * 2], sizeof(u16));
+            std::memcpy(&actual_word, &actual_memory[DataOffset + address * 2], sizeof(u16));
+            if (expected_word != actual_word) {
+                if (pass) {
+                    Print(c);
+                }
+                std::printf("Mismatch: memory_%04X: %04X != %04X\n", address, expected_word,
+                            actual_word);
+                pass = false;
+            }
+        }
+        ++ran;
+        return pass;
+    }
+
+    u64 ran = 0;
+    u64 skipped = 0;
+
+private:
+    static void Print(const Case& c) {
+        std::printf("Program:\n");
+        for (std::size_t pc = 0; pc < c.program.size(); ++pc) {
+            const u16 opcode = c.program[pc];
+            const bool expansion = Teakra::Disassembler::NeedExpansion(opcode);
+            const u16 expand = expansion ? c.program[pc + 1] : 0;
+            std::printf("  %04zX: %s\n", pc, Teakra::Disassembler::Do(opcode, expand).c_str());
+            pc += expansion;
+        }
+    }
+
+    Generator generator;
+    Teakra::Teakra interp{false};
+    Teakra::Teakra jit{true};
+};
+
+} // Anonymous namespace
+
+#ifdef TEAKRA_LIBFUZZER
+
+static Fuzzer* fuzzer;
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+    fuzzer = new Fuzzer(ProbeJit(CandidateOpcodes()));
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const u8* data, std::size_t size) {
+    Source source({data, size});
+    if (!fuzzer->RunCase(source)) {
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv) {
+    u64 iterations = 10000;
+    u64 seed = std::random_device{}();
+    if (argc > 1) {
+        iterations = std::strtoull(argv[1], nullptr, 0);
+    }
+    if (argc > 2) {
+        seed = std::strtoull(argv[2], nullptr, 0);
+    }
+
+    const auto pool = ProbeJit(CandidateOpcodes());
+    std::printf("%zu opcodes supported by both engines, seed %" PRIu64 "\n", pool.size(), seed);
+
+    Fuzzer fuzzer(pool);
+    std::mt19937_64 rng(seed);
+    std::vector<u8> input(0x4000);
+    for (u64 i = 0; i < iterations; ++i) {
+        for (auto& byte : input) {
+            byte = static_cast<u8>(rng());
+        }
+        Source source(input);
+        if (!fuzzer.RunCase(source)) {
+            std::printf("FAILED at iteration %" PRIu64 "\n", i);
+            return 1;
+        }
+    }
+    std::printf("%" PRIu64 " cases passed, %" PRIu64 " skipped\n", fuzzer.ran, fuzzer.skipped);
+    return 0;
+}
+
+#endif
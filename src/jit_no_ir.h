@@ -1,25 +1,44 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
 #include <limits.h>
+#include <mutex>
 #include <optional>
 #include <set>
+#include <string>
+#include <span>
 #include <stack>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <teakra/teakra.h>
 #include <xbyak/xbyak.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 #include "bit.h"
 #include "core_timing.h"
 #include "hash.h"
 #include "interpreter.h"
+#include "ir/basic_block.h"
+#include "ir/opcode.h"
+#include "ir/opt/passes.h"
 #include "jit_regs.h"
+#include "lockstep.h"
 #include "memory_interface.h"
 #include "mmio.h"
 #include "operand.h"
+#include "profiler.h"
 #include "register.h"
 #include "shared_memory.h"
+#include "trace.h"
+#include "translate/translate.h"
 #include "xbyak_abi.h"
 
 #ifdef _WIN32
@@ -67,11 +86,14 @@ class EmitX64 {
     // Technically there's prpage which would make this 22 bits wide, but it's always zero so
     // whatever.
     static constexpr size_t BlockCacheSize = 1ULL << 18;
+    // Blocks are only ever compiled from program memory, which precedes data memory.
+    static constexpr size_t ProgramMemorySize = MemoryInterfaceUnit::DataMemoryOffset * sizeof(u16);
 
 public:
     EmitX64(CoreTiming& core_timing, JitRegisters& regs, MemoryInterface& mem)
         : core_timing(core_timing), regs(regs), mem(mem), c(MAX_CODE_SIZE) {
         block_cache = std::make_unique<BlockList[]>(BlockCacheSize);
+        entry_counts = std::make_unique<u8[]>(BlockCacheSize);
         auto& miu = mem.memory_interface_unit;
         miu.SetOffsets(&regs.x_offset, &regs.y_offset, &regs.z_offset);
         miu.SetPageMode(&regs.page_mode);
@@ -227,6 +249,11 @@ public:
         BlockKey key{};
         BlockFunc func;
         s32 cycles;
+        bool has_stores; // Set if the block may write data memory or MMIO
+        bool optimized;  // Compiled by the optimizing tier
+        bool rep_loop;   // The instruction at the entry was compiled as a rep loop
+        s64 heat;        // Cycles spent in the block so far, including in-block loops
+        u32 code_size;   // Bytes of host code
 
         bool Matches(const BlockKey& other) {
             const u64* lhsp = (const u64*)&key;
@@ -251,13 +278,95 @@ public:
     std::set<u32> bkrep_end_locations;
     std::set<u32> rep_end_locations;
     bool compiling = false;
+    bool acc_flags_dead = false; // The instruction being compiled may skip SetAccFlag
     using BlockList = std::vector<LocationDescriptor>;
     std::unique_ptr<BlockList[]> block_cache;
+    std::vector<u32> compiled_pcs; // Indices of the non-empty block_cache entries
+    u64 program_hash{};
+    bool validate_block_cache = false;
     std::stack<u32> call_stack;
     LocationDescriptor* current_blk{};
+    u16 current_variant{}; // Index of current_blk among the blocks cached for its pc
     BlockKey block_key{};
+
+    // Out-of-line exits for in-block loops that run out of cycles, emitted after the block
+    struct SideExit {
+        Xbyak::Label label;
+        std::optional<u32> pc; // Empty if the code jumping here already stored pc
+        s32 cycles;            // Static cycles of the block executed up to this exit
+    };
+    std::deque<SideExit> side_exits;
+
+    // Instruction boundaries in the current block that a bkrep end may loop back to. Calls are
+    // compiled inline, so the same pc can be a head more than once, in different copies of the
+    // subroutine.
+    struct LoopHead {
+        Xbyak::Label label;
+        u32 pc;
+        s32 cycles;             // Static cycles of the block before the head
+        std::size_t call_depth; // Size of call_stack at the head
+    };
+    std::deque<LoopHead> loop_heads;
+    u32 next_loop_head{};
+
+    // Poll loop detection, see DetectPollLoop
+    static constexpr size_t PollSnapshotSize = offsetof(JitRegisters, loop_cycles);
+    std::array<u8, PollSnapshotSize> poll_snapshot;
+    u64 poll_write_count{};
+    bool poll_snapshot_valid = false;
+    bool poll_idle = false;
     bool unimplemented = false;
 
+    // Optimizing frontend: runs of instructions the IR supports are translated, optimized and
+    // lowered together instead of being emitted one by one.
+#ifdef TEAKRA_JIT_IR
+    bool use_ir = true;
+#else
+    bool use_ir = false;
+#endif
+    static constexpr u32 MaxIRRunLength = 32;
+
+#ifdef TEAKRA_JIT_STATS
+    static constexpr bool CollectStats = true;
+#else
+    static constexpr bool CollectStats = false;
+#endif
+    JitStats stats{}; // Only the event counters are kept up to date
+
+    // Tiering has three tiers:
+    // - Code is interpreted until the dispatcher has missed at its address WarmupEntries times,
+    //   so that code which only runs a few times, like boot code, is never compiled. A miss on
+    //   cold code leaves the dispatcher with warmup_deferred set, and the caller interprets up to
+    //   the next branch.
+    // - Warm code is compiled without the optimizations that slow compilation down: the flag
+    //   lookahead and the IR frontend.
+    // - Blocks that have run for HotBlockCycles are recompiled once with them. The quick code
+    //   stays in the buffer until the block cache is cleared, see retired_code_bytes.
+    bool tiered = false;
+    std::unique_ptr<u8[]> entry_counts; // Dispatcher misses by pc, while tiered
+    bool warmup_deferred = false;       // The last Run stopped at code that is still cold
+    u64 retired_code_bytes = 0;         // Code of blocks that have been recompiled since
+    FILE* perf_map = nullptr;
+    Profiler* profiler = nullptr; // Set while profiling
+    Tracer* tracer = nullptr;     // Set while tracing
+    u32 current_blk_pc = 0;       // Entry of the block about to run, for the profiler
+
+    LockstepVerifier* lockstep = nullptr; // Set while verifying blocks against the interpreter
+
+    static constexpr u8 WarmupEntries = 4;
+    static constexpr s64 HotBlockCycles = 0x10000;
+
+    // Background compilation: a miss leaves the dispatcher with compile_deferred set. The caller
+    // takes over the registers, hands the block to the compiler thread with QueueCompile and
+    // interprets until compile_pending is clear. The JIT doesn't run meanwhile, so the compiler
+    // thread has all of the compilation state to itself, regs.pc included.
+    std::thread compile_thread;
+    mutable std::mutex compile_mutex;
+    mutable std::condition_variable compile_cv;
+    std::atomic<bool> compile_pending{false};
+    bool compile_thread_exit = false;
+    bool compile_deferred = false; // The last Run stopped at a block that is being compiled
+
     // Emit a call to a class member function, passing "this_object" (+ an adjustment if necessary)
     // As the function's "this" pointer. Only works with classes with single, non-virtual
     // inheritance, hence the static asserts. Those are all we need though, thankfully.
@@ -284,14 +393,134 @@ public:
         CallFarFunction(c, function_ptr);
     }
 
+    ~EmitX64() {
+        SetBackgroundCompilation(false);
+        SetPerfMap(false);
+    }
+
+    void SetBackgroundCompilation(bool enabled) {
+        if (enabled == compile_thread.joinable()) {
+            return;
+        }
+        if (enabled) {
+            compile_thread_exit = false;
+            compile_thread = std::thread([this] { CompileThread(); });
+            return;
+        }
+        WaitForCompile();
+        {
+            std::lock_guard lock(compile_mutex);
+            compile_thread_exit = true;
+        }
+        compile_cv.notify_all();
+        compile_thread.join();
+    }
+
+    void CompileThread() {
+        std::unique_lock lock(compile_mutex);
+        while (true) {
+            compile_cv.wait(lock, [this] { return compile_pending || compile_thread_exit; });
+            if (compile_thread_exit) {
+                return;
+            }
+            lock.unlock();
+            CompileNewBlock(!tiered);
+            lock.lock();
+            compile_pending.store(false, std::memory_order_release);
+            compile_cv.notify_all();
+        }
+    }
+
+    /// Compiles the block at regs.pc for block_key on the compiler thread. The registers are not
+    /// to be touched until it is done.
+    void QueueCompile() {
+        {
+            std::lock_guard lock(compile_mutex);
+            compile_pending = true;
+        }
+        compile_cv.notify_all();
+    }
+
+    bool CompilePending() const {
+        return compile_pending.load(std::memory_order_acquire);
+    }
+
+    void WaitForCompile() const {
+        if (CompilePending()) {
+            std::unique_lock lock(compile_mutex);
+            compile_cv.wait(lock, [this] { return !compile_pending; });
+        }
+    }
+
+    /// Appends a line to /tmp/perf-<pid>.map for every compiled block, so that perf can name
+    /// samples in JIT code. Only available on Linux.
+    void SetPerfMap(bool enabled) {
+        WaitForCompile();
+#ifdef __linux__
+        if (enabled && !perf_map) {
+            const std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+            perf_map = std::fopen(path.c_str(), "a");
+        }
+#endif
+        if (!enabled && perf_map) {
+            std::fclose(perf_map);
+            perf_map = nullptr;
+        }
+    }
+
+    void WritePerfMapEntry(u32 pc, const u8* start, const u8* end) {
+        const u64 key_hash = Common::ComputeHash64(&current_blk->key, KeyStateSize);
+        std::fprintf(perf_map, "%llx %llx teakra_%05x_%016llx%s\n",
+                     static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(start)),
+                     static_cast<unsigned long long>(end - start), pc,
+                     static_cast<unsigned long long>(key_hash),
+                     current_blk->optimized ? "_opt" : "");
+        std::fflush(perf_map);
+    }
+
+    void SetTiered(bool enabled) {
+        WaitForCompile();
+        if (tiered != enabled) {
+            tiered = enabled;
+            ClearBlockCache();
+        }
+    }
+
     void Reset() {
+        WaitForCompile();
         // Reset registers
         regs.Reset();
 
-        // Clear any program data from previous runs
-        block_cache = std::make_unique<BlockList[]>(BlockCacheSize);
+        // Compiled blocks are kept across resets. Fingerprint the program memory they were compiled
+        // from, and only throw them away if the next run sees a different image.
+        if (!validate_block_cache && !compiled_pcs.empty()) {
+            program_hash = HashProgramMemory();
+            validate_block_cache = true;
+        }
+    }
+
+    u64 HashProgramMemory() const {
+        return Common::ComputeHash64(mem.shared_memory.raw.data(), ProgramMemorySize);
+    }
+
+    void ValidateBlockCache() {
+        validate_block_cache = false;
+        if (HashProgramMemory() != program_hash) {
+            ClearBlockCache();
+        }
+    }
+
+    void ClearBlockCache() {
+        WaitForCompile();
+        // Only visit the entries that were actually filled instead of reallocating the cache
+        for (const u32 pc : compiled_pcs) {
+            block_cache[pc].clear();
+        }
+        compiled_pcs.clear();
         bkrep_end_locations.clear();
         rep_end_locations.clear();
+        std::fill_n(entry_counts.get(), BlockCacheSize, u8{0});
+        retired_code_bytes = 0;
 
         // Reset code generator and emit the dispatcher again
         c.reset();
@@ -299,13 +528,42 @@ public:
     }
 
     u32 Run(s64 cycles) {
+        if (validate_block_cache) {
+            ValidateBlockCache();
+        }
         cycles_remaining = cycles;
         current_blk = nullptr;
         regs.idle = false;
+        compile_deferred = false;
+        warmup_deferred = false;
         run_code(this);
+        if constexpr (CollectStats) {
+            stats.cycles += cycles - cycles_remaining;
+        }
         return std::abs(cycles_remaining);
     }
 
+    JitStats GetStats(std::size_t top_n) const {
+        WaitForCompile();
+        JitStats result = stats;
+        result.code_bytes = c.getSize();
+        result.retired_code_bytes = retired_code_bytes;
+        result.cached_pcs = compiled_pcs.size();
+        for (const u32 pc : compiled_pcs) {
+            const auto variants = static_cast<u32>(block_cache[pc].size());
+            result.cached_blocks += variants;
+            result.top_variants.emplace_back(pc, variants);
+        }
+        const auto more_variants = [](const auto& lhs, const auto& rhs) {
+            return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+        };
+        auto& top = result.top_variants;
+        const auto n = static_cast<std::ptrdiff_t>(std::min(top_n, top.size()));
+        std::partial_sort(top.begin(), top.begin() + n, top.end(), more_variants);
+        top.resize(static_cast<std::size_t>(n));
+        return result;
+    }
+
     void EmitDispatcher() {
         run_code = c.getCurr<RunCodeFuncType>();
         ABI_PushRegistersAndAdjustStack(c, ABI_ALL_CALLEE_SAVED, 8, 16);
@@ -333,27 +591,49 @@ public:
             return nullptr;
         }
 
-        // State for bank exchange.
-        std::memcpy(&block_key.cfgi, &regs.cfgi, sizeof(u16) * 8);
-        // Current state
-        std::memcpy(&block_key.curr.mod1, &regs.mod1, sizeof(u16) * 3);
-        std::memcpy(&block_key.curr.arp, &regs.arp, sizeof(regs.arp) + sizeof(regs.ar));
-        // Shadow state.
-        std::memcpy(&block_key.shadow.mod1, &regs.mod1b, sizeof(u16) * 3);
-        std::memcpy(&block_key.shadow.arp, &regs.arpb, sizeof(regs.arpb) + sizeof(regs.arb));
-        LookupBlock();
+        const LocationDescriptor* previous_blk = current_blk;
+        const u32 entry_pc = regs.pc;
+        UpdateBlockKey();
+        LookupBlock(compile_thread.joinable() && !lockstep, tiered && !lockstep);
+        if (compile_deferred || warmup_deferred) {
+            poll_snapshot_valid = false;
+            poll_idle = false;
+            return nullptr;
+        }
+        DetectPollLoop(previous_blk);
+        current_blk_pc = entry_pc;
+        if constexpr (CollectStats) {
+            stats.dispatches++;
+        }
+        if (tracer) {
+            tracer->Record(TraceEventType::Block, entry_pc, current_variant);
+        }
 
         // Check if we are idle, and skip ahead
-        if (regs.idle) {
+        if (regs.idle || poll_idle) {
             u64 skipped = core_timing.Skip(cycles_remaining - 1);
             cycles_remaining -= skipped;
+            if (profiler) {
+                profiler->Advance(regs.pc, skipped);
+            }
+            if (tracer) {
+                tracer->Record(TraceEventType::Idle, regs.pc);
+                tracer->Advance(skipped);
+            }
             // Skip additional tick so to let components fire interrupts
             if (cycles_remaining > 1) {
                 cycles_remaining--;
+                if (tracer) {
+                    tracer->Advance(1);
+                }
                 core_timing.Tick();
             }
         }
 
+        // In-block loops must come back before the next timer event or the end of the slice.
+        regs.loop_cycle_limit =
+            static_cast<s64>(core_timing.GetMaxSkip(cycles_remaining)) - current_blk->cycles;
+
         // Check for interrupts.
         for (std::size_t i = 0; i < 3; ++i) {
             if (interrupt_pending[i]) {
@@ -366,28 +646,257 @@ public:
             regs.ipv = 1;
             vinterrupt_pending = false;
         }
+        interrupt_signaled = false;
+
+        if (lockstep) {
+            lockstep->BeginBlock(regs);
+        }
 
         // Return the block function to execute.
         return current_blk->func;
     }
 
-    FORCE_INLINE void LookupBlock() {
+    /// A store-free block that keeps branching back to itself, leaving the registers and memory
+    /// exactly as they were, can only be waiting on MMIO state that changes with the next event.
+    void DetectPollLoop(const LocationDescriptor* previous_blk) {
+        poll_idle = false;
+        if (current_blk != previous_blk || current_blk->has_stores) {
+            poll_snapshot_valid = false;
+            return;
+        }
+        if (poll_snapshot_valid && poll_write_count == mem.write_count &&
+            std::memcmp(poll_snapshot.data(), &regs, PollSnapshotSize) == 0) {
+            poll_idle = true;
+            return;
+        }
+        std::memcpy(poll_snapshot.data(), &regs, PollSnapshotSize);
+        poll_write_count = mem.write_count;
+        poll_snapshot_valid = true;
+    }
+
+    FORCE_INLINE void UpdateBlockKey() {
+        // State for bank exchange.
+        std::memcpy(&block_key.cfgi, &regs.cfgi, sizeof(u16) * 8);
+        // Current state
+        std::memcpy(&block_key.curr.mod1, &regs.mod1, sizeof(u16) * 3);
+        std::memcpy(&block_key.curr.arp, &regs.arp, sizeof(regs.arp) + sizeof(regs.ar));
+        // Shadow state.
+        std::memcpy(&block_key.shadow.mod1, &regs.mod1b, sizeof(u16) * 3);
+        std::memcpy(&block_key.shadow.arp, &regs.arpb, sizeof(regs.arpb) + sizeof(regs.arb));
+    }
+
+    /// Compiles the block at `pc` for the current register state without running it.
+    void Precompile(u32 pc) {
+        WaitForCompile();
+        if (validate_block_cache) {
+            ValidateBlockCache();
+        }
+        const u32 saved_pc = regs.pc;
+        regs.pc = pc;
+        UpdateBlockKey();
+        LookupBlock();
+        regs.pc = saved_pc;
+    }
+
+    // A precompile list records which blocks were compiled, so that a later run of the same
+    // program can compile them all up front instead of stopping to compile them as they are
+    // reached. Only the keys are saved, the code is compiled again. Bump the version whenever the
+    // key layout changes.
+    static constexpr u32 BlockListMagic = 0x4C504B54; // "TKPL"
+    static constexpr u32 BlockListVersion = 1;
+    static constexpr std::size_t KeyStateSize = offsetof(BlockKey, mask);
+
+    struct BlockListHeader {
+        u32 magic;
+        u32 version;
+        u64 program_hash;
+        u32 num_rep_ends;
+        u32 num_bkrep_ends;
+        u32 num_blocks;
+        u32 pad;
+    };
+
+    struct BlockListEntry {
+        u32 pc;
+        u32 optimized;
+        std::array<u8, KeyStateSize> key;
+    };
+
+    std::vector<u8> SaveBlockList() {
+        WaitForCompile();
+        if (validate_block_cache) {
+            ValidateBlockCache();
+        }
+        BlockListHeader header{};
+        header.magic = BlockListMagic;
+        header.version = BlockListVersion;
+        header.program_hash = HashProgramMemory();
+        header.num_rep_ends = static_cast<u32>(rep_end_locations.size());
+        header.num_bkrep_ends = static_cast<u32>(bkrep_end_locations.size());
+        for (const u32 pc : compiled_pcs) {
+            header.num_blocks += static_cast<u32>(block_cache[pc].size());
+        }
+
+        std::vector<u8> data(sizeof(header) +
+                             sizeof(u32) * (header.num_rep_ends + header.num_bkrep_ends) +
+                             sizeof(BlockListEntry) * header.num_blocks);
+        u8* out = data.data();
+        const auto write = [&out](const void* src, std::size_t size) {
+            std::memcpy(out, src, size);
+            out += size;
+        };
+        write(&header, sizeof(header));
+        for (const u32 pc : rep_end_locations) {
+            write(&pc, sizeof(pc));
+        }
+        for (const u32 pc : bkrep_end_locations) {
+            write(&pc, sizeof(pc));
+        }
+        for (const u32 pc : compiled_pcs) {
+            for (const auto& desc : block_cache[pc]) {
+                BlockListEntry entry{};
+                entry.pc = pc;
+                entry.optimized = desc.optimized;
+                std::memcpy(entry.key.data(), &desc.key, KeyStateSize);
+                write(&entry, sizeof(entry));
+            }
+        }
+        return data;
+    }
+
+    /// Compiles the blocks listed by SaveBlockList. Fails without compiling anything if the list
+    /// is malformed or was saved for another program image.
+    bool LoadBlockList(std::span<const u8> data) {
+        WaitForCompile();
+        if (validate_block_cache) {
+            ValidateBlockCache();
+        }
+        BlockListHeader header;
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.magic != BlockListMagic || header.version != BlockListVersion ||
+            header.program_hash != HashProgramMemory()) {
+            return false;
+        }
+        const u64 size = sizeof(header) +
+                         sizeof(u32) * (u64{header.num_rep_ends} + header.num_bkrep_ends) +
+                         sizeof(BlockListEntry) * u64{header.num_blocks};
+        if (data.size() != size) {
+            return false;
+        }
+
+        const u8* in = data.data() + sizeof(header);
+        const auto read_pc = [&in] {
+            u32 pc;
+            std::memcpy(&pc, in, sizeof(pc));
+            in += sizeof(pc);
+            return pc & (BlockCacheSize - 1);
+        };
+        // Loop ends change how blocks are compiled, so they have to be known first
+        for (u32 i = 0; i < header.num_rep_ends; i++) {
+            rep_end_locations.insert(read_pc());
+        }
+        for (u32 i = 0; i < header.num_bkrep_ends; i++) {
+            bkrep_end_locations.insert(read_pc());
+        }
+
+        const u32 saved_pc = regs.pc;
+        for (u32 i = 0; i < header.num_blocks; i++) {
+            BlockListEntry entry;
+            std::memcpy(&entry, in, sizeof(entry));
+            in += sizeof(entry);
+            regs.pc = entry.pc & (BlockCacheSize - 1);
+            std::memcpy(&block_key, entry.key.data(), KeyStateSize);
+            auto& vec = block_cache[regs.pc];
+            if (std::none_of(vec.begin(), vec.end(),
+                             [this](auto& desc) { return desc.Matches(block_key); })) {
+                CompileNewBlock(!tiered || entry.optimized);
+            }
+        }
+        regs.pc = saved_pc;
+        return true;
+    }
+
+    /// With `defer`, a miss is left for the compiler thread instead of compiled here. With
+    /// `warm_up`, a miss on cold code is left for the interpreter.
+    FORCE_INLINE void LookupBlock(bool defer = false, bool warm_up = false) {
+        // A rep interrupted by the cycle limit resumes at its repeated instruction. Make sure
+        // that runs as a loop even if a plain block was cached for it before.
+        if (regs.rep) {
+            rep_end_locations.insert(regs.pc);
+        }
+
         auto& vec = block_cache[regs.pc];
         for (auto& desc : vec) {
             if (desc.Matches(block_key)) {
                 current_blk = &desc;
+                current_variant = static_cast<u16>(&desc - vec.data());
+                if constexpr (CollectStats) {
+                    stats.lookup_hits++;
+                }
+                if (regs.rep && !desc.rep_loop) {
+                    RecompileBlock(desc.optimized);
+                } else if (tiered && !desc.optimized && desc.heat >= HotBlockCycles) {
+                    RecompileBlock(true);
+                }
                 return;
             }
         }
 
+        if constexpr (CollectStats) {
+            stats.lookup_misses++;
+        }
+        if (warm_up && entry_counts[regs.pc] < WarmupEntries) {
+            entry_counts[regs.pc]++;
+            warmup_deferred = true;
+            return;
+        }
+        if (defer) {
+            compile_deferred = true;
+            return;
+        }
+        CompileNewBlock(!tiered);
+        // printf("Compiling block at 0x%x with size = %d\n", blk_key.pc, blk.cycles);
+    }
+
+    void CompileNewBlock(bool optimized) {
+        auto& vec = block_cache[regs.pc];
+        if (vec.empty()) {
+            compiled_pcs.push_back(regs.pc);
+        }
         auto& desc = vec.emplace_back();
         desc.key = block_key;
+        desc.optimized = optimized;
         current_blk = &desc;
+        current_variant = static_cast<u16>(vec.size() - 1);
+        CompileBlock();
+    }
+
+    // Replaces the code of the current block in place, so that its slot in block_cache and
+    // compiled_pcs stays valid. The old code stays in the buffer until the block cache is cleared.
+    void RecompileBlock(bool optimized) {
+        retired_code_bytes += current_blk->code_size;
+        *current_blk = LocationDescriptor{};
+        current_blk->key = block_key;
+        current_blk->optimized = optimized;
         CompileBlock();
-        // printf("Compiling block at 0x%x with size = %d\n", blk_key.pc, blk.cycles);
     }
 
     void DoInterruptsAndRunDebug() {
+        if (lockstep) {
+            lockstep->EndBlock(regs, current_blk->cycles + regs.loop_cycles);
+        }
+        if (tracer) {
+            tracer->Advance(current_blk->cycles + regs.loop_cycles);
+            // reti is compiled inline, so the exit is seen at the end of its block
+            if (tracer->in_interrupt && regs.ie) {
+                tracer->in_interrupt = false;
+                tracer->Record(TraceEventType::InterruptExit, regs.pc);
+            }
+        }
+
         if (regs.ie && !regs.rep) {
             bool interrupt_handled = false;
             for (u32 i = 0; i < regs.im.size(); ++i) {
@@ -398,6 +907,11 @@ public:
                     regs.pc = 0x0006 + i * 8;
                     regs.idle = false;
                     interrupt_handled = true;
+                    if (tracer) {
+                        tracer->in_interrupt = true;
+                        tracer->Record(TraceEventType::InterruptEnter, regs.pc,
+                                       static_cast<u16>(i));
+                    }
                     if (regs.ic[i]) {
                         ContextStore();
                     }
@@ -410,18 +924,29 @@ public:
                 PushPC();
                 regs.pc = vinterrupt_address;
                 regs.idle = false;
+                if (tracer) {
+                    tracer->in_interrupt = true;
+                    tracer->Record(TraceEventType::InterruptEnter, regs.pc, 3);
+                }
                 if (vinterrupt_context_switch) {
                     ContextStore();
                 }
             }
         }
 
-        // Count the cycles of the previous executed block.
-        core_timing.Tick(current_blk->cycles);
-        cycles_remaining -= current_blk->cycles;
+        // Count the cycles of the previous executed block, including in-block loop iterations.
+        const s64 cycles = current_blk->cycles + regs.loop_cycles;
+        regs.loop_cycles = 0;
+        current_blk->heat += cycles;
+        if (profiler) {
+            profiler->Advance(current_blk_pc, cycles);
+        }
+        core_timing.Tick(cycles);
+        cycles_remaining -= cycles;
     }
 
     void CompileBlock() {
+        const u32 start_pc = regs.pc;
         // Load block state
         current_blk->func = c.getCurr<BlockFunc>();
         c.mov(REGS, ABI_PARAM1);
@@ -433,17 +958,39 @@ public:
         c.mov(B[0], qword[REGS + offsetof(JitRegisters, b)]);
         c.mov(B[1], qword[REGS + offsetof(JitRegisters, b) + sizeof(u64)]);
         c.mov(FLAGS, word[REGS + offsetof(JitRegisters, flags)]);
+        c.movzx(SP.cvt32(), word[REGS + offsetof(JitRegisters, sp)]);
 
         call_stack = {};
         block_key.SetMask(&current_blk->mask);
+        current_blk->rep_loop = rep_end_locations.contains(start_pc);
 
         // Disassembler::ArArpSettings settings;
         // std::memcpy(&settings.ar, &blk_key.curr.ar, sizeof(settings.ar));
         // std::memcpy(&settings.arp, &blk_key.curr.arp, sizeof(settings.arp));
 
+        // The block entry is always a valid loop head, bkrep adds the start of its body.
+        loop_heads.clear();
+        next_loop_head = regs.pc;
+
         compiling = true;
         while (compiling) {
             const u32 current_pc = regs.pc;
+            if (current_pc == next_loop_head) {
+                auto& head = loop_heads.emplace_back();
+                head.pc = current_pc;
+                head.cycles = current_blk->cycles;
+                head.call_depth = call_stack.size();
+                c.L(head.label);
+            }
+
+            const bool is_rep_target = rep_end_locations.contains(current_pc);
+            Xbyak::Label rep_loop;
+            if (is_rep_target) {
+                c.L(rep_loop);
+            } else if (use_ir && current_blk->optimized && CompileIRRun()) {
+                continue;
+            }
+
             u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
             auto& decoder = decoders[opcode];
             u16 expand_value = 0;
@@ -451,22 +998,18 @@ public:
                 expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
             }
 
+            // Nothing can observe the flags between this instruction and the next one, as long as
+            // this one falls through to it within the block, and is neither repeated nor the end
+            // of a bkrep body. Otherwise the flags are live at the block exit or the jump.
+            acc_flags_dead = current_blk->optimized && !is_rep_target &&
+                             !bkrep_end_locations.contains(regs.pc - 1) &&
+                             IsStraightLine(current_pc) && OverwritesAccFlags(regs.pc);
             decoder.call(*this, opcode, expand_value);
+            acc_flags_dead = false;
             current_blk->cycles++;
 
-            if (rep_end_locations.contains(current_pc)) {
-                Xbyak::Label end_label, jump_back_label;
-                c.cmp(word[REGS + offsetof(JitRegisters, repc)], 0);
-                c.jnz(jump_back_label);
-                c.mov(word[REGS + offsetof(JitRegisters, rep)], false);
-                c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc); // Loop done, move to next
-                c.jmp(end_label);
-                c.L(jump_back_label);
-                c.sub(word[REGS + offsetof(JitRegisters, repc)],
-                      1); // Loop not done, go back to current
-                c.mov(dword[REGS + offsetof(JitRegisters, pc)], current_pc);
-                c.L(end_label);
-                compiling = false;
+            if (is_rep_target) {
+                EmitRepEnd(current_pc, rep_loop);
             }
 
             if (bkrep_end_locations.contains(regs.pc - 1)) {
@@ -485,6 +1028,366 @@ public:
 
         // Flush block state
         EmitBlockExit();
+
+        for (auto& side_exit : side_exits) {
+            c.L(side_exit.label);
+            c.add(qword[REGS + offsetof(JitRegisters, loop_cycles)],
+                  side_exit.cycles - current_blk->cycles);
+            if (side_exit.pc) {
+                c.mov(dword[REGS + offsetof(JitRegisters, pc)], *side_exit.pc);
+            }
+            EmitBlockExit();
+        }
+        side_exits.clear();
+        current_blk->code_size =
+            static_cast<u32>(c.getCurr() - reinterpret_cast<const u8*>(current_blk->func));
+
+        if constexpr (CollectStats) {
+            stats.compiled_blocks++;
+            // Every instruction is counted as one cycle
+            stats.compiled_instructions += current_blk->cycles;
+        }
+
+        if (perf_map) {
+            WritePerfMapEntry(start_pc, reinterpret_cast<const u8*>(current_blk->func),
+                              c.getCurr());
+        }
+
+        // regs.pc served as the compile cursor. The block has not run yet, so put back its entry.
+        regs.pc = start_pc;
+    }
+
+    // Translates the single instruction at the location of `block`. Returns false if the IR
+    // frontend doesn't support it.
+    bool TranslateOne(IR::Block& block) {
+        const auto program_read = [this](u32 addr) {
+            return mem.ProgramRead(addr | (regs.prpage << 18));
+        };
+        return IR::Translate(block, program_read, [](u32) { return false; }, 1) == 1;
+    }
+
+    // Whether the instruction at pc always continues with the next one in the same block. The
+    // instructions the IR frontend supports never branch or change static state.
+    bool IsStraightLine(u32 pc) {
+        IR::Block block{IR::LocationDescriptor{pc}};
+        return TranslateOne(block);
+    }
+
+    // Whether the instruction at pc sets fz/fm/fe/fn without reading them first. Only the
+    // instructions the IR frontend supports are recognized, since none of them read flags.
+    bool OverwritesAccFlags(u32 pc) {
+        IR::Block block{IR::LocationDescriptor{pc}};
+        if (!TranslateOne(block)) {
+            return false;
+        }
+        return std::any_of(block.begin(), block.end(), [](const IR::Inst& inst) {
+            return inst.GetOpcode() == IR::Opcode::SetAccFlag;
+        });
+    }
+
+    // Translates the run of IR-supported instructions at regs.pc, optimizes it and emits it.
+    // Returns false without emitting anything if the run is too short to be worth it.
+    bool CompileIRRun() {
+        const u32 start_pc = regs.pc;
+        IR::Block block{IR::LocationDescriptor{start_pc}};
+
+        // Peek at the static state without touching the key mask, in case the run is discarded
+        IR::StaticRegs state;
+        state.sat = block_key.curr.mod0.sat != 0;
+        state.sata = block_key.curr.mod0.sata != 0;
+        state.hwm = block_key.curr.mod0.hwm;
+        state.page = block_key.curr.mod1.page;
+        block.SetEntryState(state);
+
+        const auto program_read = [this](u32 pc) {
+            return mem.ProgramRead(pc | (regs.prpage << 18));
+        };
+        // Loop ends need their instruction to be followed by the rep/bkrep epilogue
+        const auto stop_before = [this](u32 pc) {
+            return rep_end_locations.contains(pc) || bkrep_end_locations.contains(pc) ||
+                   bkrep_end_locations.contains(pc + 1);
+        };
+        const u32 count = IR::Translate(block, program_read, stop_before, MaxIRRunLength);
+        if (count < 2) {
+            return false;
+        }
+
+        Optimization::GetSetElimination(block);
+        Optimization::DeadFlagElimination(block);
+        Optimization::ConstantFolding(block);
+        Optimization::DeadCodeElimination(block);
+        Optimization::IdentityRemoval(block);
+        Optimization::NamingPass(block);
+        Optimization::VerificationPass(block);
+
+        const auto slots = AllocateIRValueSlots(block);
+        if (!slots) {
+            return false;
+        }
+
+        // The translation depended on these
+        block_key.GetMod0();
+        block_key.GetMod1();
+
+        EmitIR(block, *slots);
+        regs.pc = static_cast<u32>(block.EndLocation().Value());
+        current_blk->cycles += count;
+        return true;
+    }
+
+    // Assigns each value-producing instruction a slot in JitRegisters::ir_values, reusing slots
+    // after the last use of their value. Indexed by instruction name.
+    std::optional<std::vector<u8>> AllocateIRValueSlots(const IR::Block& block) {
+        std::vector<u32> last_use(block.size() + 1, 0);
+        for (const auto& inst : block) {
+            for (size_t i = 0; i < inst.NumArgs(); i++) {
+                const IR::Value arg = inst.GetArg(i);
+                if (!arg.IsImmediate()) {
+                    last_use[arg.GetInst()->GetName()] = inst.GetName();
+                }
+            }
+        }
+
+        std::vector<u8> slots(block.size() + 1, 0);
+        std::vector<u8> free_slots;
+        for (u32 i = JitRegisters::IRValueSlots; i > 0; i--) {
+            free_slots.push_back(static_cast<u8>(i - 1));
+        }
+        for (const auto& inst : block) {
+            for (size_t i = 0; i < inst.NumArgs(); i++) {
+                const IR::Value arg = inst.GetArg(i);
+                if (!arg.IsImmediate() && last_use[arg.GetInst()->GetName()] == inst.GetName()) {
+                    free_slots.push_back(slots[arg.GetInst()->GetName()]);
+                    // A value used twice by the same instruction is only released once
+                    last_use[arg.GetInst()->GetName()] = 0;
+                }
+            }
+            if (inst.HasUses()) {
+                if (free_slots.empty()) {
+                    return std::nullopt;
+                }
+                slots[inst.GetName()] = free_slots.back();
+                free_slots.pop_back();
+            }
+        }
+        return slots;
+    }
+
+    void EmitIR(const IR::Block& block, const std::vector<u8>& slots) {
+        const auto slot = [&](const IR::Inst* inst) {
+            return qword[REGS + offsetof(JitRegisters, ir_values) +
+                         sizeof(u64) * slots[inst->GetName()]];
+        };
+        // 16-bit values are kept zero-extended
+        const auto load = [&](Reg64 reg, const IR::Value& value) {
+            if (value.IsImmediate()) {
+                c.mov(reg, value.GetImmediateAsU64());
+            } else {
+                c.mov(reg, slot(value.GetInst()));
+            }
+        };
+        const auto fits_imm32 = [](const IR::Value& value) {
+            if (!value.IsImmediate()) {
+                return false;
+            }
+            const u64 imm = value.GetImmediateAsU64();
+            return static_cast<s64>(imm) == static_cast<s32>(imm);
+        };
+
+        const Reg64 result = rax;
+        const Reg64 operand = rcx;
+        for (const auto& inst : block) {
+            switch (inst.GetOpcode()) {
+            case IR::Opcode::GetRegister16:
+                RegToBus16(inst.GetArg(0).GetRegName(), result);
+                c.movzx(result.cvt32(), result.cvt16());
+                break;
+            case IR::Opcode::GetAcc:
+                GetAcc(result, inst.GetArg(0).GetRegName());
+                break;
+            case IR::Opcode::SetRegister16:
+                load(result, inst.GetArg(1));
+                RegFromBus16(inst.GetArg(0).GetRegName(), result);
+                break;
+            case IR::Opcode::SetAcc:
+                load(result, inst.GetArg(1));
+                SetAcc(inst.GetArg(0).GetRegName(), result);
+                break;
+            case IR::Opcode::SetAccFlag:
+                if (inst.GetArg(0).IsImmediate()) {
+                    SetAccFlag(inst.GetArg(0).GetU64());
+                } else {
+                    load(result, inst.GetArg(0));
+                    SetAccFlag(result);
+                }
+                break;
+            case IR::Opcode::SaturateAcc: {
+                Reg64 value = result;
+                load(value, inst.GetArg(0));
+                if (inst.GetArg(1).GetU1()) {
+                    SaturateAcc<true>(value);
+                } else {
+                    SaturateAcc<false>(value);
+                }
+                break;
+            }
+            case IR::Opcode::SignExtend64:
+                load(result, inst.GetArg(0));
+                SignExtend(result, inst.GetArg(1).GetU8());
+                break;
+            case IR::Opcode::ZeroExtend16To64:
+                load(result, inst.GetArg(0));
+                c.movzx(result.cvt32(), result.cvt16());
+                break;
+            case IR::Opcode::LogicalShiftLeft64:
+                load(result, inst.GetArg(0));
+                c.shl(result, inst.GetArg(1).GetU8());
+                break;
+            case IR::Opcode::LogicalShiftRight64:
+                load(result, inst.GetArg(0));
+                c.shr(result, inst.GetArg(1).GetU8());
+                break;
+            case IR::Opcode::And64:
+            case IR::Opcode::Or64:
+            case IR::Opcode::Xor64: {
+                load(result, inst.GetArg(0));
+                const IR::Value rhs = inst.GetArg(1);
+                const auto op = inst.GetOpcode();
+                if (fits_imm32(rhs)) {
+                    const u32 imm = static_cast<u32>(rhs.GetImmediateAsU64());
+                    if (op == IR::Opcode::And64) {
+                        c.and_(result, imm);
+                    } else if (op == IR::Opcode::Or64) {
+                        c.or_(result, imm);
+                    } else {
+                        c.xor_(result, imm);
+                    }
+                } else {
+                    load(operand, rhs);
+                    if (op == IR::Opcode::And64) {
+                        c.and_(result, operand);
+                    } else if (op == IR::Opcode::Or64) {
+                        c.or_(result, operand);
+                    } else {
+                        c.xor_(result, operand);
+                    }
+                }
+                break;
+            }
+            case IR::Opcode::ExtractHalf64:
+                load(result, inst.GetArg(0));
+                c.shr(result, 16 * inst.GetArg(1).GetU8());
+                c.movzx(result.cvt32(), result.cvt16());
+                break;
+            case IR::Opcode::Add16:
+            case IR::Opcode::Sub16:
+                load(result, inst.GetArg(0));
+                load(operand, inst.GetArg(1));
+                if (inst.GetOpcode() == IR::Opcode::Add16) {
+                    c.add(result.cvt16(), operand.cvt16());
+                } else {
+                    c.sub(result.cvt16(), operand.cvt16());
+                }
+                c.movzx(result.cvt32(), result.cvt16());
+                break;
+            case IR::Opcode::ReadMemory16:
+                load(operand, inst.GetArg(0));
+                EmitLoadFromMemory(result, operand);
+                c.movzx(result.cvt32(), result.cvt16());
+                break;
+            case IR::Opcode::WriteMemory16:
+                load(operand, inst.GetArg(0));
+                load(result, inst.GetArg(1));
+                StoreToMemory(operand, result);
+                break;
+            default:
+                UNREACHABLE();
+            }
+
+            if (inst.HasUses()) {
+                c.mov(slot(&inst), result);
+            }
+        }
+    }
+
+    void EmitRepEnd(u32 rep_pc, const Xbyak::Label& rep_loop) {
+        // if (regs.rep) {
+        //     if (regs.repc == 0) {
+        //         regs.rep = false;
+        //     } else {
+        //         --regs.repc;
+        //         goto rep_loop;
+        //     }
+        // }
+        Xbyak::Label end_label, next_iteration;
+        c.cmp(byte[REGS + offsetof(JitRegisters, rep)], 0);
+        c.jz(end_label, c.T_NEAR);
+        c.cmp(word[REGS + offsetof(JitRegisters, repc)], 0);
+        c.jnz(next_iteration);
+        c.mov(byte[REGS + offsetof(JitRegisters, rep)], 0);
+        if (!compiling) {
+            c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc); // Loop done, move to next
+        }
+        c.jmp(end_label, c.T_NEAR);
+        c.L(next_iteration);
+        c.sub(word[REGS + offsetof(JitRegisters, repc)], 1);
+        if (!compiling) {
+            // The instruction ended the block, so each iteration goes through the dispatcher
+            c.mov(dword[REGS + offsetof(JitRegisters, pc)], rep_pc);
+        } else {
+            auto& side_exit = side_exits.emplace_back();
+            side_exit.pc = rep_pc;
+            side_exit.cycles = current_blk->cycles;
+            c.mov(rax, qword[REGS + offsetof(JitRegisters, loop_cycles)]);
+            c.cmp(rax, qword[REGS + offsetof(JitRegisters, loop_cycle_limit)]);
+            c.jge(side_exit.label, c.T_NEAR);
+            c.add(qword[REGS + offsetof(JitRegisters, loop_cycles)], 1);
+            c.jmp(rep_loop, c.T_NEAR);
+        }
+        c.L(end_label);
+    }
+
+    /// Jumps to `exit` if the cycle limit is reached or an interrupt could be taken.
+    void EmitLoopCheck(const Xbyak::Label& exit) {
+        static_assert(offsetof(JitRegisters, ipv) == offsetof(JitRegisters, ip) + sizeof(u16) * 3);
+        static_assert(offsetof(JitRegisters, imv) == offsetof(JitRegisters, im) + sizeof(u16) * 3);
+        Xbyak::Label no_interrupt;
+        c.mov(rax, qword[REGS + offsetof(JitRegisters, loop_cycles)]);
+        c.cmp(rax, qword[REGS + offsetof(JitRegisters, loop_cycle_limit)]);
+        c.jge(exit, c.T_NEAR);
+        c.mov(rax, reinterpret_cast<uintptr_t>(&interrupt_signaled));
+        c.cmp(byte[rax], 0);
+        c.jne(exit, c.T_NEAR);
+        // (ip0 & im0) | (ip1 & im1) | (ip2 & im2) | (ipv & imv)
+        c.mov(rax, qword[REGS + offsetof(JitRegisters, ip)]);
+        c.and_(rax, qword[REGS + offsetof(JitRegisters, im)]);
+        c.jz(no_interrupt);
+        c.cmp(word[REGS + offsetof(JitRegisters, ie)], 0);
+        c.jne(exit, c.T_NEAR);
+        c.L(no_interrupt);
+    }
+
+    /// Loops back to the head of the block repeat body if this block compiled it, otherwise
+    /// returns to the dispatcher. ebx holds the start address, which is already stored as pc.
+    /// Only the latest head in the same copy of an inlined call is the start of this body.
+    void EmitBkrepLoopBack(u32 end) {
+        auto& side_exit = side_exits.emplace_back();
+        side_exit.cycles = current_blk->cycles;
+        for (auto it = loop_heads.rbegin(); it != loop_heads.rend(); ++it) {
+            const auto& head = *it;
+            if (head.pc > end || head.call_depth != call_stack.size()) {
+                continue;
+            }
+            Xbyak::Label next_head;
+            c.cmp(ebx, head.pc);
+            c.jne(next_head, c.T_NEAR);
+            EmitLoopCheck(side_exit.label);
+            c.add(qword[REGS + offsetof(JitRegisters, loop_cycles)],
+                  current_blk->cycles - head.cycles);
+            c.jmp(head.label, c.T_NEAR);
+            c.L(next_head);
+        }
+        c.jmp(side_exit.label, c.T_NEAR);
     }
 
     void EmitBlockExit() {
@@ -496,6 +1399,7 @@ public:
         c.mov(qword[REGS + offsetof(JitRegisters, b)], B[0]);
         c.mov(qword[REGS + offsetof(JitRegisters, b) + sizeof(u64)], B[1]);
         c.mov(word[REGS + offsetof(JitRegisters, flags)], FLAGS.cvt16());
+        c.mov(word[REGS + offsetof(JitRegisters, sp)], SP.cvt16());
         c.jmp(block_exit);
     }
 
@@ -510,36 +1414,43 @@ public:
         //         regs.pc = regs.bkrep_stack[regs.bcn - 1].start;
         //      }
         // }
+        // If the instruction did not end the block, the paths that leave the loop simply fall
+        // through to the next instruction.
+        const u32 end = regs.pc - 1;
         Xbyak::Label end_label, jump_to_target;
         const Reg64 bcn = rax;
         c.test(word[REGS + offsetof(JitRegisters, lp)], 0x1);
-        c.jz(end_label);
+        c.jz(end_label, c.T_NEAR);
         c.movzx(bcn, word[REGS + offsetof(JitRegisters, bcn)]);
         c.sub(bcn, 1);
         c.lea(rbx, ptr[bcn + bcn * 2]);
         c.lea(rbx, ptr[REGS + offsetof(JitRegisters, bkrep_stack) + rbx * 4]);
-        c.cmp(dword[rbx + offsetof(Frame, end)], regs.pc - 1);
-        c.jne(end_label);
+        c.cmp(dword[rbx + offsetof(Frame, end)], end);
+        c.jne(end_label, c.T_NEAR);
         c.cmp(word[rbx + offsetof(Frame, lc)], 0);
         c.jne(jump_to_target);
         c.mov(word[REGS + offsetof(JitRegisters, bcn)], bcn.cvt16());
         c.test(bcn, bcn);
         c.setnz(byte[REGS + offsetof(JitRegisters, lp)]);
-        c.mov(dword[REGS + offsetof(JitRegisters, pc)], next_pc);
-        c.jmp(end_label);
+        if (!compiling) {
+            c.mov(dword[REGS + offsetof(JitRegisters, pc)], next_pc);
+        }
+        c.jmp(end_label, c.T_NEAR);
         c.L(jump_to_target);
         c.sub(word[rbx + offsetof(Frame, lc)], 1);
         c.mov(rbx.cvt32(), dword[rbx + offsetof(Frame, start)]);
         c.mov(dword[REGS + offsetof(JitRegisters, pc)], rbx.cvt32());
+        if (compiling) {
+            EmitBkrepLoopBack(end);
+        }
         c.L(end_label);
-        compiling = false;
     }
 
     void EmitPushPC() {
         u16 l = (u16)(regs.pc & 0xFFFF);
         u16 h = (u16)(regs.pc >> 16);
         const Reg16 sp = bx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.mov(sp, SP.cvt16());
         c.sub(sp, 1);
         if (regs.cpc == 1) {
             NOT_IMPLEMENTED();
@@ -548,7 +1459,7 @@ public:
             c.sub(sp, 1);
             StoreToMemory(sp, h);
         }
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
 
     void PushPC() {
@@ -565,21 +1476,21 @@ public:
 
     void EmitPopPC() {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 pc = rcx;
         c.xor_(pc, pc);
         if (regs.cpc == 1) {
             NOT_IMPLEMENTED();
         } else {
             EmitLoadFromMemory<true>(pc, sp);
-            c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+            c.movzx(sp.cvt32(), SP.cvt16());
             c.add(sp, 1);
             c.shl(pc, 16);
             EmitLoadFromMemory<true>(pc, sp);
-            c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+            c.movzx(sp.cvt32(), SP.cvt16());
             c.add(sp, 2);
         }
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
         c.mov(dword[REGS + offsetof(JitRegisters, pc)], pc.cvt32());
     }
 
@@ -603,17 +1514,20 @@ public:
 
     void SignalInterrupt(u32 i) {
         interrupt_pending[i] = true;
+        interrupt_signaled = true;
     }
     void SignalVectoredInterrupt(u32 address, bool context_switch) {
         vinterrupt_address = address;
         vinterrupt_pending = true;
         vinterrupt_context_switch = context_switch;
+        interrupt_signaled = true;
     }
 
     using instruction_return_type = void;
 
     std::array<bool, 3> interrupt_pending{};
     bool vinterrupt_pending{false};
+    bool interrupt_signaled{false}; // Set by either of the above, polled by in-block loops
     bool vinterrupt_context_switch;
     u32 vinterrupt_address;
 
@@ -2121,14 +3035,12 @@ public:
         c.or_(rbx, 1 << 16);
         c.mov(dword[REGS + offsetof(JitRegisters, bcn)], rbx.cvt32());
         static_assert(offsetof(JitRegisters, lp) - offsetof(JitRegisters, bcn) == sizeof(u16));
-        // TODO: Block linking so small loops dont go the dispatcher
+        // Keep compiling into the body, so that the end of the repeat can loop back in-block.
         bkrep_end_locations.insert(address);
-        c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc);
-        compiling = false;
+        next_loop_head = regs.pc;
     }
 
     void bkrep(Imm8 a, Address16 addr) {
-        // TODO: Can probably inline a loop for this with some checks
         const Reg64 lc = rax;
         c.mov(lc, a.Unsigned16());
         u32 address = addr.Address32() | (regs.pc & 0x30000);
@@ -2242,18 +3154,18 @@ public:
     }
     void bkreprst_memsp() {
         const Reg64 sp = rbx;
-        c.movzx(sp.cvt32(), word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         RestoreBlockRepeat(sp);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void bkrepsto(ArRn2 a) {
         NOT_IMPLEMENTED();
     }
     void bkrepsto_memsp() {
         const Reg64 sp = rbx;
-        c.movzx(sp.cvt32(), word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         StoreBlockRepeat(sp);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
 
     void banke(BankFlags flags) {
@@ -2487,7 +3399,7 @@ public:
     }
     void rets(Imm8 a) {
         EmitPopPC();
-        c.add(word[REGS + offsetof(JitRegisters, sp)], a.Unsigned16());
+        c.add(SP.cvt16(), a.Unsigned16());
         if (!call_stack.empty()) {
             regs.pc = call_stack.top();
             call_stack.pop();
@@ -2558,29 +3470,29 @@ public:
 
     void push(Imm16 a) {
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, a.Unsigned16());
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push(Register a) {
         const Reg64 value = rbx;
         RegToBus16(a.GetName(), value, true);
         const Reg64 sp = rcx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push(Abe a) {
         const Reg64 value = rbx;
         GetAndSatAcc(value, a.GetName());
         c.shr(value, 32);
         const Reg64 sp = rcx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
 
     std::optional<u16> IsArpArpSttModConst(ArArpSttMod a) {
@@ -2610,17 +3522,17 @@ public:
 
     void push(ArArpSttMod a) {
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         if (auto value = IsArpArpSttModConst(a); value.has_value()) {
             StoreToMemory(sp, value.value());
-            c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+            c.mov(SP.cvt16(), sp.cvt16());
             return;
         }
         const Reg64 value = rax;
         RegToBus16(a.GetName(), value);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push_prpage() {
         NOT_IMPLEMENTED();
@@ -2629,100 +3541,100 @@ public:
         const Reg64 value = rbx;
         ProductToBus40(value, a);
         const Reg64 sp = rcx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
         c.sub(sp, 1);
         c.shr(value, 16);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push_r6() {
         const Reg64 value = rax;
         RegToBus16(RegName::r6, value);
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push_repc() {
         const Reg64 value = rax;
         c.mov(value, word[REGS + offsetof(JitRegisters, repc)]);
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push_x0() {
         const Reg64 value = rax;
         c.rorx(value, FACTORS, 32);
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push_x1() {
         const Reg64 value = rax;
         c.rorx(value, FACTORS, 48);
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void push_y1() {
         const Reg64 value = rax;
         c.rorx(value, FACTORS, 16);
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void pusha(Ax a) {
         const Reg64 value = rbx;
         GetAndSatAcc(value, a.GetName());
         const Reg64 sp = rcx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
         c.sub(sp, 1);
         c.shr(value, 16);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
     void pusha(Bx a) {
         const Reg64 value = rbx;
         GetAndSatAcc(value, a.GetName());
         const Reg64 sp = rcx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         c.sub(sp, 1);
         StoreToMemory(sp, value);
         c.sub(sp, 1);
         c.shr(value, 16);
         StoreToMemory(sp, value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
 
     void pop(Register a) {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         RegFromBus16(a.GetName(), value);
     }
     void pop(Abe a) {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         const Reg32 tmp =
             eax; // Register used just for truncating the accumulator register to 32 bits
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         c.movsx(value.cvt32(), value.cvt8());
         c.shl(value, 32);
         // Zero-extend bottom 32 bits of accumulator to tmp.cvt64() and merge it into value
@@ -2732,10 +3644,10 @@ public:
     }
     void pop(ArArpSttMod a) {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         RegFromBus16(a.GetName(), value);
     }
     void pop(Bx a) {
@@ -2746,58 +3658,58 @@ public:
     }
     void pop(Px a) {
         const Reg64 sp = rbx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         LoadFromMemory(value, sp);
         c.add(sp, 1);
         c.shl(value, 16);
         LoadFromMemory(value, sp);
         c.add(sp, 1);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
         ProductFromBus32(a, value.cvt32());
     }
     void pop_r6() {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         RegFromBus16(RegName::r6, value);
     }
     void pop_repc() {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         c.mov(word[REGS + offsetof(JitRegisters, repc)], value.cvt16());
     }
     void pop_x0() {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         c.rorx(FACTORS, FACTORS, 32);
         c.mov(FACTORS.cvt16(), value.cvt16());
         c.rorx(FACTORS, FACTORS, 32);
     }
     void pop_x1() {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         c.rorx(FACTORS, FACTORS, 48);
         c.mov(FACTORS.cvt16(), value.cvt16());
         c.rorx(FACTORS, FACTORS, 16);
     }
     void pop_y1() {
         const Reg64 sp = rbx;
-        c.movzx(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         const Reg64 value = rcx;
         EmitLoadFromMemory<true>(value, sp);
-        c.add(word[REGS + offsetof(JitRegisters, sp)], 1);
+        c.add(SP.cvt16(), 1);
         c.rorx(FACTORS, FACTORS, 16);
         c.mov(FACTORS.cvt16(), value.cvt16());
         c.rorx(FACTORS, FACTORS, 48);
@@ -2805,7 +3717,7 @@ public:
     void popa(Ab a) {
         const Reg64 value = rbx;
         const Reg64 sp = rcx;
-        c.mov(sp, word[REGS + offsetof(JitRegisters, sp)]);
+        c.movzx(sp.cvt32(), SP.cvt16());
         LoadFromMemory(value, sp);
         c.add(sp, 1);
         c.shl(value, 16);
@@ -2813,30 +3725,20 @@ public:
         c.add(sp, 1);
         SignExtend(value, 32);
         SetAccAndFlag(a.GetName(), value);
-        c.mov(word[REGS + offsetof(JitRegisters, sp)], sp.cvt16());
+        c.mov(SP.cvt16(), sp.cvt16());
     }
 
+    // The repeated instruction is compiled as an in-block loop by CompileBlock (see EmitRepEnd)
     void rep(Imm8 a) {
-        u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-        auto& decoder = decoders[opcode];
-        u16 expand_value = 0;
-        if (decoder.NeedExpansion()) {
-            expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-        }
-
-        for (int i = 0; i <= a.Unsigned16(); i++) {
-            decoder.call(*this, opcode, expand_value);
-            current_blk->cycles++;
-            ASSERT(compiling); // Ensure the instruction doesn't break the block
-        }
+        c.mov(byte[REGS + offsetof(JitRegisters, rep)], 1);
+        c.mov(word[REGS + offsetof(JitRegisters, repc)], a.Unsigned16());
+        rep_end_locations.insert(regs.pc);
     }
     void rep(Register a) {
         const Reg64 value = rax;
         RegToBus16(a.GetName(), value);
-        c.mov(word[REGS + offsetof(JitRegisters, rep)], true);
+        c.mov(byte[REGS + offsetof(JitRegisters, rep)], 1);
         c.mov(word[REGS + offsetof(JitRegisters, repc)], value.cvt16());
-        c.mov(dword[REGS + offsetof(JitRegisters, pc)], regs.pc);
-        compiling = false;
         rep_end_locations.insert(regs.pc);
     }
     void rep_r6() {
@@ -3148,6 +4050,7 @@ public:
 
     template <typename T1, typename T2>
     void StoreToMemory(T1 addr, T2 value) {
+        current_blk->has_stores = true;
         // TODO: Non MMIO writes can be performed inside the JIT.
         // Push all registers because our JIT assumes everything is non volatile
         c.push(rbp);
@@ -4318,7 +5221,7 @@ private:
             break;
 
         case RegName::sp:
-            c.movzx(out, word[REGS + offsetof(JitRegisters, sp)]);
+            c.movzx(out.cvt32(), SP.cvt16());
             break;
         case RegName::sv:
             c.mov(out, word[REGS + offsetof(JitRegisters, sv)]);
@@ -4512,7 +5415,7 @@ private:
             compiling = false; // Modifies static state, end block
             break;
         case RegName::sp:
-            c.mov(word[REGS + offsetof(JitRegisters, sp)], value.cvt16());
+            c.mov(SP.cvt16(), value.cvt16());
             break;
         case RegName::y0:
             c.mov(FACTORS.cvt16(), value.cvt16());
@@ -4685,7 +5588,7 @@ private:
             break;
 
         case RegName::sp:
-            c.mov(word[REGS + offsetof(JitRegisters, sp)], value);
+            c.mov(SP.cvt16(), value);
             break;
         case RegName::mod0:
             block_key.GetMod0().raw = value;
@@ -4759,6 +5662,9 @@ private:
 
     template <typename T>
     void SetAccFlag(T value) {
+        if (acc_flags_dead) {
+            return;
+        }
         constexpr u16 ACC_MASK = ~(decltype(Flags::fz)::mask | decltype(Flags::fm)::mask |
                                    decltype(Flags::fe)::mask | decltype(Flags::fn)::mask);
         if constexpr (std::is_base_of_v<Xbyak::Reg, T>) {
@@ -32,6 +32,9 @@ constexpr Reg64 FACTORS = r14;
 constexpr Reg64 REGS = r15;
 /// Holds commonly used status flags
 constexpr Reg32 FLAGS = edi;
+/// Holds the XpertTeak stack pointer, zero-extended. rbp is otherwise only used as a frame
+/// pointer around host calls, which restore it.
+constexpr Reg64 SP = rbp;
 
 // Most frequently accessed status registers, or registers with no cross refrences are stored
 // directly by the JIT for speed These registers are also used in a static manner as it greatly
@@ -489,6 +492,17 @@ struct JitRegisters {
     std::array<u16, 3> imb{}; // interrupt enable bit
     u16 imvb = 0;
 
+    /** JIT bookkeeping, not architectural state **/
+
+    // Cycles run by in-block loops on top of the static cycle count of the current block
+    s64 loop_cycles = 0;
+    // In-block loops return to the dispatcher once loop_cycles reaches this
+    s64 loop_cycle_limit = 0;
+
+    // Values of IR instructions between their definition and last use, see EmitX64::EmitIR
+    static constexpr u32 IRValueSlots = 32;
+    std::array<u64, IRValueSlots> ir_values{};
+
     void ShadowStore(Xbyak::CodeGenerator& c) {
         c.mov(word[REGS + offsetof(JitRegisters, flagsb)], FLAGS);
     }
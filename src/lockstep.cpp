@@ -0,0 +1,491 @@
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <teakra/disassembler.h>
+#include "interpreter.h"
+#include "jit_regs.h"
+#include "lockstep.h"
+#include "shared_memory.h"
+
+namespace Teakra {
+
+namespace {
+
+// The registers that bank exchange swaps with their shadows
+void LoadBanked(RegisterState& regs, u16 pcmhi, Mod0 m0, Mod1 m1, Mod2 m2,
+                const std::array<u16, 3>& im, u16 imv, const std::array<ArU, 2>& ar,
+                const std::array<ArpU, 4>& arp) {
+    regs.pcmhi = pcmhi;
+    regs.Set<mod0>(m0.raw);
+    regs.Set<mod1>(m1.raw);
+    regs.Set<mod2>(m2.raw);
+    regs.im = im;
+    regs.imv = imv;
+    regs.Set<ar0>(ar[0].raw);
+    regs.Set<ar1>(ar[1].raw);
+    regs.Set<arp0>(arp[0].raw);
+    regs.Set<arp1>(arp[1].raw);
+    regs.Set<arp2>(arp[2].raw);
+    regs.Set<arp3>(arp[3].raw);
+}
+
+void LoadFlags(RegisterState& regs, Flags flags) {
+    regs.Set<stt0>((flags.raw >> 1) & Stt0::Mask());
+    regs.fr = flags.fr;
+}
+
+void StoreBanked(const RegisterState& regs, u16& pcmhi, Mod0& m0, Mod1& m1, Mod2& m2,
+                 std::array<u16, 3>& im, u16& imv, std::array<ArU, 2>& ar,
+                 std::array<ArpU, 4>& arp) {
+    pcmhi = regs.pcmhi;
+    m0.raw = regs.Get<mod0>();
+    m1.raw = regs.Get<mod1>();
+    m2.raw = regs.Get<mod2>();
+    im = regs.im;
+    imv = regs.imv;
+    ar[0].raw = regs.Get<ar0>();
+    ar[1].raw = regs.Get<ar1>();
+    arp[0].raw = regs.Get<arp0>();
+    arp[1].raw = regs.Get<arp1>();
+    arp[2].raw = regs.Get<arp2>();
+    arp[3].raw = regs.Get<arp3>();
+}
+
+Flags StoreFlags(const RegisterState& regs) {
+    Flags flags{};
+    flags.raw = static_cast<u16>(regs.Get<stt0>() << 1);
+    flags.fr.Assign(regs.fr);
+    return flags;
+}
+
+using RegisterList = std::vector<std::pair<std::string, u64>>;
+
+RegisterList Describe(RegisterState regs, bool idle) {
+    RegisterList list;
+    const auto add = [&list](std::string name, u64 value) {
+        list.emplace_back(std::move(name), value);
+    };
+    add("pc", regs.pc);
+    add("prpage", regs.prpage);
+    add("repc", regs.repc);
+    add("repcs", regs.repcs);
+    add("rep", regs.rep);
+    add("lc", regs.bkrep_stack[0].lc);
+    for (u16 i = 0; i < regs.bcn && i < regs.bkrep_stack.size(); ++i) {
+        const auto& frame = regs.bkrep_stack[i];
+        const std::string prefix = "bkrep" + std::to_string(i);
+        add(prefix + ".start", frame.start);
+        add(prefix + ".end", frame.end);
+        add(prefix + ".lc", frame.lc);
+    }
+    add("a0", regs.a[0]);
+    add("a1", regs.a[1]);
+    add("b0", regs.b[0]);
+    add("b1", regs.b[1]);
+    add("a1s", regs.a1s);
+    add("b1s", regs.b1s);
+    add("p0", regs.p[0]);
+    add("p1", regs.p[1]);
+    add("p0h_cbs", regs.p0h_cbs);
+    add("x0", regs.x[0]);
+    add("x1", regs.x[1]);
+    add("y0", regs.y[0]);
+    add("y1", regs.y[1]);
+    for (std::size_t i = 0; i < regs.r.size(); ++i) {
+        add("r" + std::to_string(i), regs.r[i]);
+    }
+    add("r0b", regs.r0b);
+    add("r1b", regs.r1b);
+    add("r4b", regs.r4b);
+    add("r7b", regs.r7b);
+    add("mixp", regs.mixp);
+    add("sp", regs.sp);
+    add("sv", regs.sv);
+    add("vtr0", regs.vtr0);
+    add("vtr1", regs.vtr1);
+    add("stt0", regs.Get<stt0>());
+    add("stt1", regs.Get<stt1>());
+    add("stt2", regs.Get<stt2>());
+    add("mod0", regs.Get<mod0>());
+    add("mod1", regs.Get<mod1>());
+    add("mod2", regs.Get<mod2>());
+    add("mod3", regs.Get<mod3>());
+    add("cfgi", regs.Get<cfgi>());
+    add("cfgj", regs.Get<cfgj>());
+    add("stepi0", regs.stepi0);
+    add("stepj0", regs.stepj0);
+    add("cfgib", regs.stepib | regs.modib << 7);
+    add("cfgjb", regs.stepjb | regs.modjb << 7);
+    add("stepi0b", regs.stepi0b);
+    add("stepj0b", regs.stepj0b);
+    add("ar0", regs.Get<ar0>());
+    add("ar1", regs.Get<ar1>());
+    add("arp0", regs.Get<arp0>());
+    add("arp1", regs.Get<arp1>());
+    add("arp2", regs.Get<arp2>());
+    add("arp3", regs.Get<arp3>());
+    for (std::size_t i = 0; i < regs.ext.size(); ++i) {
+        add("ext" + std::to_string(i), regs.ext[i]);
+    }
+    add("idle", idle);
+
+    // The shadows can only be read by bringing them back, which is fine on this copy
+    regs.ShadowRestore();
+    add("stt0 shadow", regs.Get<stt0>());
+    add("stt1 shadow", regs.Get<stt1>());
+    regs.ShadowSwap();
+    add("stt2 shadow", regs.Get<stt2>());
+    add("mod0 shadow", regs.Get<mod0>());
+    add("mod1 shadow", regs.Get<mod1>());
+    add("mod2 shadow", regs.Get<mod2>());
+    add("mod3 shadow", regs.Get<mod3>());
+    add("ar0 shadow", regs.Get<ar0>());
+    add("ar1 shadow", regs.Get<ar1>());
+    add("arp0 shadow", regs.Get<arp0>());
+    add("arp1 shadow", regs.Get<arp1>());
+    add("arp2 shadow", regs.Get<arp2>());
+    add("arp3 shadow", regs.Get<arp3>());
+    return list;
+}
+
+std::string DescribeAccess(const AccessJournal::Access& access) {
+    char line[64];
+    switch (access.space) {
+    case AccessJournal::Space::Data:
+        std::snprintf(line, sizeof(line), "data %05X = %04X",
+                      access.address - MemoryInterfaceUnit::DataMemoryOffset, access.value);
+        break;
+    case AccessJournal::Space::Program:
+        std::snprintf(line, sizeof(line), "program %05X = %04X", access.address, access.value);
+        break;
+    case AccessJournal::Space::MMIO:
+        std::snprintf(line, sizeof(line), "mmio %03X = %04X", access.address, access.value);
+        break;
+    }
+    return line;
+}
+
+// Index of the first access that differs, or of the first one only one of the lists has
+template <typename Compare>
+std::size_t FirstDifference(const std::vector<AccessJournal::Access>& lhs,
+                            const std::vector<AccessJournal::Access>& rhs, Compare compare) {
+    std::size_t i = 0;
+    while (i < lhs.size() && i < rhs.size() && compare(lhs[i], rhs[i])) {
+        ++i;
+    }
+    return i;
+}
+
+// Lists at most this many of the instructions the block ran
+constexpr std::size_t MaxListedInstructions = 64;
+
+} // Anonymous namespace
+
+void ToRegisterState(const JitRegisters& jit_regs, RegisterState& regs) {
+    const JitRegisters& j = jit_regs;
+    regs = RegisterState();
+
+    // The interpreter keeps its shadows private, so they are set by loading them as the current
+    // registers and storing or swapping them away
+    LoadBanked(regs, j.pcmhib, j.mod0b, j.mod1b, j.mod2b, j.imb, j.imvb, j.arb, j.arpb);
+    LoadFlags(regs, j.flagsb);
+    regs.ShadowStore();
+    regs.ShadowSwap();
+    LoadBanked(regs, j.pcmhi, j.mod0, j.mod1, j.mod2, j.im, j.imv, j.ar, j.arp);
+    LoadFlags(regs, j.flags);
+
+    regs.pc = j.pc;
+    regs.prpage = j.prpage;
+    regs.cpc = j.cpc;
+    regs.repc = j.repc;
+    regs.repcs = j.repcs;
+    regs.rep = j.rep;
+    regs.crep = j.crep;
+    regs.bcn = j.bcn;
+    regs.lp = j.lp;
+    for (std::size_t i = 0; i < regs.bkrep_stack.size(); ++i) {
+        regs.bkrep_stack[i].start = j.bkrep_stack[i].start;
+        regs.bkrep_stack[i].end = j.bkrep_stack[i].end;
+        regs.bkrep_stack[i].lc = j.bkrep_stack[i].lc;
+    }
+
+    regs.a = j.a;
+    regs.b = j.b;
+    regs.a1s = j.a1s;
+    regs.b1s = j.b1s;
+    regs.ccnta = j.ccnta;
+    regs.sv = j.sv;
+    regs.vtr0 = j.vtr0;
+    regs.vtr1 = j.vtr1;
+
+    regs.x = j.x;
+    regs.y = j.y;
+    regs.p = j.p;
+    regs.pe = j.pe;
+    regs.p0h_cbs = j.p0h_cbs;
+
+    regs.r = j.r;
+    regs.mixp = j.mixp;
+    regs.sp = j.sp;
+    regs.r0b = j.r0b;
+    regs.r1b = j.r1b;
+    regs.r4b = j.r4b;
+    regs.r7b = j.r7b;
+
+    regs.Set<cfgi>(j.cfgi.raw);
+    regs.Set<cfgj>(j.cfgj.raw);
+    regs.stepi0 = j.stepi0;
+    regs.stepj0 = j.stepj0;
+    regs.stepib = j.cfgib.step;
+    regs.modib = j.cfgib.mod;
+    regs.stepjb = j.cfgjb.step;
+    regs.modjb = j.cfgjb.mod;
+    regs.stepi0b = j.stepi0b;
+    regs.stepj0b = j.stepj0b;
+
+    regs.ip = j.ip;
+    regs.ipv = j.ipv;
+    regs.ic = j.ic;
+    regs.nimc = j.nimc;
+    regs.ie = j.ie;
+
+    // ou0 and ou1 are part of mod0
+    for (std::size_t i = 2; i < regs.ou.size(); ++i) {
+        regs.ou[i] = j.ou[i];
+    }
+    regs.iu = j.iu;
+    regs.ext = j.ext;
+}
+
+void FromRegisterState(const RegisterState& regs, JitRegisters& jit_regs) {
+    JitRegisters& j = jit_regs;
+    StoreBanked(regs, j.pcmhi, j.mod0, j.mod1, j.mod2, j.im, j.imv, j.ar, j.arp);
+    j.flags = StoreFlags(regs);
+
+    // The shadows can only be read by bringing them back, which is fine on a copy
+    RegisterState shadow = regs;
+    shadow.ShadowRestore();
+    j.flagsb = StoreFlags(shadow);
+    shadow.ShadowSwap();
+    StoreBanked(shadow, j.pcmhib, j.mod0b, j.mod1b, j.mod2b, j.imb, j.imvb, j.arb, j.arpb);
+
+    j.pc = regs.pc;
+    j.prpage = regs.prpage;
+    j.cpc = regs.cpc;
+    j.repc = regs.repc;
+    j.repcs = regs.repcs;
+    j.rep = regs.rep;
+    j.crep = regs.crep;
+    j.bcn = regs.bcn;
+    j.lp = regs.lp;
+    for (std::size_t i = 0; i < regs.bkrep_stack.size(); ++i) {
+        j.bkrep_stack[i].start = regs.bkrep_stack[i].start;
+        j.bkrep_stack[i].end = regs.bkrep_stack[i].end;
+        j.bkrep_stack[i].lc = regs.bkrep_stack[i].lc;
+    }
+
+    j.a = regs.a;
+    j.b = regs.b;
+    j.a1s = regs.a1s;
+    j.b1s = regs.b1s;
+    j.ccnta = regs.ccnta;
+    j.sv = regs.sv;
+    j.vtr0 = regs.vtr0;
+    j.vtr1 = regs.vtr1;
+
+    j.x = regs.x;
+    j.y = regs.y;
+    j.p = regs.p;
+    j.pe = regs.pe;
+    j.p0h_cbs = regs.p0h_cbs;
+
+    j.r = regs.r;
+    j.mixp = regs.mixp;
+    j.sp = regs.sp;
+    j.r0b = regs.r0b;
+    j.r1b = regs.r1b;
+    j.r4b = regs.r4b;
+    j.r7b = regs.r7b;
+
+    j.cfgi.raw = regs.Get<cfgi>();
+    j.cfgj.raw = regs.Get<cfgj>();
+    j.stepi0 = regs.stepi0;
+    j.stepj0 = regs.stepj0;
+    j.cfgib.step.Assign(regs.stepib);
+    j.cfgib.mod.Assign(regs.modib);
+    j.cfgjb.step.Assign(regs.stepjb);
+    j.cfgjb.mod.Assign(regs.modjb);
+    j.stepi0b = regs.stepi0b;
+    j.stepj0b = regs.stepj0b;
+
+    j.ip = regs.ip;
+    j.ipv = regs.ipv;
+    j.ic = regs.ic;
+    j.nimc = regs.nimc;
+    j.ie = regs.ie;
+
+    for (std::size_t i = 2; i < regs.ou.size(); ++i) {
+        j.ou[i] = regs.ou[i];
+    }
+    j.iu = regs.iu;
+    j.ext = regs.ext;
+    j.idle = 0;
+    j.loop_cycles = 0;
+}
+
+LockstepVerifier::LockstepVerifier(Interpreter& interpreter, MemoryInterface& mem)
+    : interpreter(interpreter), mem(mem) {}
+
+LockstepVerifier::~LockstepVerifier() {
+    if (mem.journal == &journal) {
+        mem.journal = nullptr;
+    }
+}
+
+void LockstepVerifier::BeginBlock(const JitRegisters& regs) {
+    if (Diverged()) {
+        return;
+    }
+    ToRegisterState(regs, before);
+    block_pc = regs.pc;
+    journal.Start(false);
+    mem.journal = &journal;
+}
+
+void LockstepVerifier::EndBlock(const JitRegisters& regs, u64 cycles) {
+    if (mem.journal != &journal) {
+        return;
+    }
+
+    // Take back the JIT's writes so that the replay starts from the same memory
+    mem.journal = nullptr;
+    jit_writes.swap(journal.writes);
+    ApplyWrites(jit_writes, true);
+
+    interpreter.regs = before;
+    interpreter.idle = regs.idle != 0;
+    executed_pcs.clear();
+    write_pcs.clear();
+    read_pcs.clear();
+    u32 last_pc = block_pc;
+    journal.Start(true);
+    mem.journal = &journal;
+    try {
+        for (u64 i = 0; i < cycles; ++i) {
+            last_pc = interpreter.regs.pc;
+            if (executed_pcs.size() < MaxListedInstructions &&
+                std::find(executed_pcs.begin(), executed_pcs.end(), last_pc) ==
+                    executed_pcs.end()) {
+                executed_pcs.push_back(last_pc);
+            }
+            interpreter.Replay(1);
+            write_pcs.resize(journal.writes.size(), last_pc);
+            read_pcs.resize(journal.replayed_mmio_reads.size(), last_pc);
+        }
+    } catch (const UnimplementedException&) {
+        // Nothing to compare with, keep the JIT's results
+        mem.journal = nullptr;
+        ApplyWrites(journal.writes, true);
+        ApplyWrites(jit_writes, false);
+        return;
+    }
+    mem.journal = nullptr;
+
+    char line[256];
+    std::string reason;
+    const auto pc_of = [last_pc](const std::vector<u32>& pcs, std::size_t index) {
+        return index < pcs.size() ? pcs[index] : last_pc;
+    };
+
+    const auto& reads = journal.replayed_mmio_reads;
+    const std::size_t read_index = FirstDifference(
+        reads, journal.mmio_reads,
+        [](const auto& lhs, const auto& rhs) { return lhs.address == rhs.address; });
+    if (read_index != reads.size() || read_index != journal.mmio_reads.size()) {
+        std::snprintf(line, sizeof(line),
+                      "MMIO read %zu at %05X: interpreter reads %03X, JIT read %03X (%zu vs %zu "
+                      "reads)\n",
+                      read_index, pc_of(read_pcs, read_index),
+                      read_index < reads.size() ? reads[read_index].address : 0xFFFu,
+                      read_index < journal.mmio_reads.size()
+                          ? journal.mmio_reads[read_index].address
+                          : 0xFFFu,
+                      reads.size(), journal.mmio_reads.size());
+        reason += line;
+    }
+
+    const auto& writes = journal.writes;
+    const std::size_t write_index =
+        FirstDifference(writes, jit_writes, std::equal_to<AccessJournal::Access>{});
+    if (write_index != writes.size() || write_index != jit_writes.size()) {
+        std::snprintf(line, sizeof(line), "write %zu at %05X: interpreter %s, JIT %s\n",
+                      write_index, pc_of(write_pcs, write_index),
+                      write_index < writes.size() ? DescribeAccess(writes[write_index]).c_str()
+                                                  : "none",
+                      write_index < jit_writes.size()
+                          ? DescribeAccess(jit_writes[write_index]).c_str()
+                          : "none");
+        reason += line;
+    }
+
+    RegisterState after;
+    ToRegisterState(regs, after);
+    const auto expected = Describe(interpreter.regs, interpreter.idle);
+    const auto actual = Describe(after, regs.idle != 0);
+    for (std::size_t i = 0; i < expected.size() && i < actual.size(); ++i) {
+        if (expected[i] != actual[i]) {
+            std::snprintf(line, sizeof(line), "%s: interpreter %010llX, JIT %010llX\n",
+                          expected[i].first.c_str(),
+                          static_cast<unsigned long long>(expected[i].second & 0xFF'FFFF'FFFF),
+                          static_cast<unsigned long long>(actual[i].second & 0xFF'FFFF'FFFF));
+            reason += line;
+        }
+    }
+    if (expected.size() != actual.size()) {
+        reason += "block repeat nesting differs\n";
+    }
+
+    if (!reason.empty()) {
+        // Leave memory as the JIT wrote it
+        ApplyWrites(writes, true);
+        ApplyWrites(jit_writes, false);
+        Diverge(std::move(reason));
+    }
+}
+
+void LockstepVerifier::ApplyWrites(const std::vector<AccessJournal::Access>& writes, bool undo) {
+    const auto apply = [this, undo](const AccessJournal::Access& access) {
+        if (access.space != AccessJournal::Space::MMIO) {
+            mem.shared_memory.WriteWord(access.address, undo ? access.old_value : access.value);
+        }
+    };
+    if (undo) {
+        std::for_each(writes.rbegin(), writes.rend(), apply);
+    } else {
+        std::for_each(writes.begin(), writes.end(), apply);
+    }
+}
+
+void LockstepVerifier::Diverge(std::string reason) {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "Lockstep verification: JIT and interpreter diverge in the block at %05X\n",
+                  block_pc);
+    report = line;
+    report += reason;
+    report += "Instructions run by the block:\n";
+    for (const u32 pc : executed_pcs) {
+        const u32 page = static_cast<u32>(before.prpage) << 18;
+        const u16 opcode = mem.ProgramRead(pc | page);
+        const u16 expansion =
+            Disassembler::NeedExpansion(opcode) ? mem.ProgramRead((pc + 1) | page) : 0;
+        std::snprintf(line, sizeof(line), "  %05X  %s\n", pc,
+                      Disassembler::Do(opcode, expansion).c_str());
+        report += line;
+    }
+    std::printf("%s", report.c_str());
+}
+
+} // namespace Teakra
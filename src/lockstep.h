@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+#include "memory_interface.h"
+#include "register.h"
+
+namespace Teakra {
+
+class Interpreter;
+struct JitRegisters;
+
+/// Converts the JIT register layout, including the shadow banks, to the interpreter's.
+void ToRegisterState(const JitRegisters& jit_regs, RegisterState& regs);
+/// The reverse, for handing the interpreter's state back to the JIT. The JIT's copies of the MIU
+/// settings are left as they are.
+void FromRegisterState(const RegisterState& regs, JitRegisters& jit_regs);
+
+/// Replays every JIT block on the interpreter, starting from the same registers and memory, and
+/// compares the resulting registers and the memory writes of both. MMIO is only accessed by the
+/// JIT; the replay reads the values the JIT read. The JIT's results are kept either way. The
+/// first divergence is reported and ends the verification.
+class LockstepVerifier {
+public:
+    /// `interpreter` must run on `mem`, the memory interface of the JIT being verified.
+    LockstepVerifier(Interpreter& interpreter, MemoryInterface& mem);
+    ~LockstepVerifier();
+
+    LockstepVerifier(const LockstepVerifier&) = delete;
+    LockstepVerifier& operator=(const LockstepVerifier&) = delete;
+
+    void BeginBlock(const JitRegisters& regs);
+    void EndBlock(const JitRegisters& regs, u64 cycles);
+
+    bool Diverged() const {
+        return !report.empty();
+    }
+
+    /// Empty until a divergence is found
+    const std::string& Report() const {
+        return report;
+    }
+
+    Interpreter& GetInterpreter() const {
+        return interpreter;
+    }
+
+private:
+    void ApplyWrites(const std::vector<AccessJournal::Access>& writes, bool undo);
+    void Diverge(std::string reason);
+
+    Interpreter& interpreter;
+    MemoryInterface& mem;
+    AccessJournal journal;
+    std::vector<AccessJournal::Access> jit_writes;
+    // PC of the instruction that made each write and MMIO read of the replay
+    std::vector<u32> write_pcs;
+    std::vector<u32> read_pcs;
+    std::vector<u32> executed_pcs;
+    RegisterState before;
+    u32 block_pc = 0;
+    std::string report;
+};
+
+} // namespace Teakra
@@ -39,6 +39,11 @@ public:
         return name;
     }
 
+    // Name and expected bits, unique per entry of the decode table
+    const std::string& GetIdentifier() const {
+        return identifier;
+    }
+
     bool NeedExpansion() const {
         return expanded;
     }
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include "memory_interface.h"
 #include "mmio.h"
 #include "shared_memory.h"
+#include "trace.h"
 
 namespace Teakra {
 MemoryInterface::MemoryInterface(SharedMemory& shared_memory,
@@ -12,12 +14,21 @@ u16 MemoryInterface::ProgramRead(u32 address) const {
 }
 
 void MemoryInterface::ProgramWrite(u32 address, u16 value) {
+    ++write_count;
+    if (journal) {
+        journal->writes.push_back(
+            {AccessJournal::Space::Program, address, value, shared_memory.ReadWord(address)});
+    }
     shared_memory.WriteWord(address, value);
 }
 
 u16 MemoryInterface::DataRead(u16 address, bool bypass_mmio) {
     if (memory_interface_unit.InMMIO(address) && !bypass_mmio) {
-        return mmio.Read(memory_interface_unit.ToMMIO(address));
+        const u16 offset = memory_interface_unit.ToMMIO(address);
+        if (journal) {
+            return JournalMMIORead(offset);
+        }
+        return ReadMMIO(offset);
     }
     u32 converted = memory_interface_unit.ConvertDataAddress(address);
     u16 value = shared_memory.ReadWord(converted);
@@ -25,13 +36,49 @@ u16 MemoryInterface::DataRead(u16 address, bool bypass_mmio) {
 }
 
 void MemoryInterface::DataWrite(u16 address, u16 value, bool bypass_mmio) {
+    ++write_count;
     if (memory_interface_unit.InMMIO(address) && !bypass_mmio) {
-        return mmio.Write(memory_interface_unit.ToMMIO(address), value);
+        const u16 offset = memory_interface_unit.ToMMIO(address);
+        if (journal) {
+            journal->writes.push_back({AccessJournal::Space::MMIO, offset, value, 0});
+            if (journal->replay) {
+                return;
+            }
+        }
+        if (tracer) {
+            tracer->Record(TraceEventType::MMIOWrite, offset, value);
+        }
+        return mmio.Write(offset, value);
     }
     u32 converted = memory_interface_unit.ConvertDataAddress(address);
+    if (journal) {
+        journal->writes.push_back(
+            {AccessJournal::Space::Data, converted, value, shared_memory.ReadWord(converted)});
+    }
     shared_memory.WriteWord(converted, value);
 }
 
+u16 MemoryInterface::JournalMMIORead(u16 offset) {
+    if (!journal->replay) {
+        const u16 value = ReadMMIO(offset);
+        journal->mmio_reads.push_back({AccessJournal::Space::MMIO, offset, value, 0});
+        return value;
+    }
+    // Reads past the recorded ones get zero, the verifier reports the difference in count
+    const std::size_t index = journal->replayed_mmio_reads.size();
+    const u16 value = index < journal->mmio_reads.size() ? journal->mmio_reads[index].value : 0;
+    journal->replayed_mmio_reads.push_back({AccessJournal::Space::MMIO, offset, value, 0});
+    return value;
+}
+
+u16 MemoryInterface::ReadMMIO(u16 offset) {
+    const u16 value = mmio.Read(offset);
+    if (tracer) {
+        tracer->Record(TraceEventType::MMIORead, offset, value);
+    }
+    return value;
+}
+
 u16 MemoryInterface::DataReadA32(u32 address) const {
     u32 converted = (address & ((MemoryInterfaceUnit::DataMemoryBankSize * 2) - 1)) +
                     MemoryInterfaceUnit::DataMemoryOffset;
@@ -39,11 +86,53 @@ u16 MemoryInterface::DataReadA32(u32 address) const {
 }
 
 void MemoryInterface::DataWriteA32(u32 address, u16 value) {
+    ++write_count;
     u32 converted = (address & ((MemoryInterfaceUnit::DataMemoryBankSize * 2) - 1)) +
                     MemoryInterfaceUnit::DataMemoryOffset;
     shared_memory.WriteWord(converted, value);
 }
 
+// Program memory ends where data memory begins
+bool MemoryInterface::ProgramReadBlock(u32 address, std::span<u16> out) const {
+    if (u64{address} + out.size() > MemoryInterfaceUnit::DataMemoryOffset) {
+        return false;
+    }
+    return shared_memory.ReadWords(address, out);
+}
+
+bool MemoryInterface::ProgramWriteBlock(u32 address, std::span<const u16> data) {
+    if (u64{address} + data.size() > MemoryInterfaceUnit::DataMemoryOffset ||
+        !shared_memory.WriteWords(address, data)) {
+        return false;
+    }
+    ++write_count;
+    return true;
+}
+
+// The A32 block transfers wrap around the data memory the same way the single-word versions do
+void MemoryInterface::DataReadA32Block(u32 address, std::span<u16> out) const {
+    constexpr u32 mask = (MemoryInterfaceUnit::DataMemoryBankSize * 2) - 1;
+    while (!out.empty()) {
+        const u32 offset = address & mask;
+        const std::size_t count = std::min<std::size_t>(out.size(), mask + 1 - offset);
+        shared_memory.ReadWords(offset + MemoryInterfaceUnit::DataMemoryOffset, out.first(count));
+        out = out.subspan(count);
+        address = 0;
+    }
+}
+
+void MemoryInterface::DataWriteA32Block(u32 address, std::span<const u16> data) {
+    ++write_count;
+    constexpr u32 mask = (MemoryInterfaceUnit::DataMemoryBankSize * 2) - 1;
+    while (!data.empty()) {
+        const u32 offset = address & mask;
+        const std::size_t count = std::min<std::size_t>(data.size(), mask + 1 - offset);
+        shared_memory.WriteWords(offset + MemoryInterfaceUnit::DataMemoryOffset, data.first(count));
+        data = data.subspan(count);
+        address = 0;
+    }
+}
+
 u16 MemoryInterface::MMIORead(u16 address) {
     // according to GBATek ("DSi Teak I/O Ports (on ARM9 Side)"), these are mirrored
     return mmio.Read(address & (MemoryInterfaceUnit::MMIOSize - 1));
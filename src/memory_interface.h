@@ -2,6 +2,8 @@
 
 #include <array>
 #include <bit>
+#include <span>
+#include <vector>
 #include "common_types.h"
 #include "crash.h"
 
@@ -80,6 +82,40 @@ public:
 struct SharedMemory;
 class MMIORegion;
 
+/// DSP-visible accesses recorded while lockstep verification runs a JIT block, and checked
+/// against the interpreter's replay of it. See LockstepVerifier.
+struct AccessJournal {
+    enum class Space : u8 { Data, Program, MMIO };
+    struct Access {
+        Space space;
+        u32 address; // converted address for data memory, offset into the region for MMIO
+        u16 value;
+        u16 old_value; // memory contents before a write
+
+        bool operator==(const Access& other) const {
+            return space == other.space && address == other.address && value == other.value;
+        }
+    };
+
+    std::vector<Access> writes;
+    std::vector<Access> mmio_reads;
+    // While replaying, MMIO reads return the recorded values and MMIO writes are only recorded,
+    // so that the peripherals see the accesses once
+    bool replay = false;
+    std::vector<Access> replayed_mmio_reads;
+
+    void Start(bool replay_) {
+        replay = replay_;
+        writes.clear();
+        replayed_mmio_reads.clear();
+        if (!replay) {
+            mmio_reads.clear();
+        }
+    }
+};
+
+class Tracer;
+
 class MemoryInterface {
 public:
     MemoryInterface(SharedMemory& shared_memory, MemoryInterfaceUnit& memory_interface_unit,
@@ -91,13 +127,25 @@ public:
     void DataWrite(u16 address, u16 value, bool bypass_mmio = false);
     u16 DataReadA32(u32 address) const;
     void DataWriteA32(u32 address, u16 value);
+    bool ProgramReadBlock(u32 address, std::span<u16> out) const;
+    bool ProgramWriteBlock(u32 address, std::span<const u16> data);
+    void DataReadA32Block(u32 address, std::span<u16> out) const;
+    void DataWriteA32Block(u32 address, std::span<const u16> data);
     u16 MMIORead(u16 address);
     void MMIOWrite(u16 address, u16 value);
     SharedMemory& GetMemory() {
         return shared_memory;
     }
 
+private:
+    u16 JournalMMIORead(u16 offset);
+    u16 ReadMMIO(u16 offset);
+
 public:
+    // Bumped by every DSP-visible write, so that idle detection can tell that memory is unchanged
+    u64 write_count = 0;
+    AccessJournal* journal = nullptr;
+    Tracer* tracer = nullptr; // Set while tracing, records the DSP's MMIO accesses
     SharedMemory& shared_memory;
     MemoryInterfaceUnit& memory_interface_unit;
     MMIORegion& mmio;
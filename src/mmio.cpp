@@ -2,6 +2,7 @@
 #include <string>
 #include <type_traits>
 #include <vector>
+#include <teakra/teakra.h>
 #include "ahbm.h"
 #include "apbp.h"
 #include "btdmp.h"
@@ -120,6 +121,7 @@ struct Cell {
 class MMIORegion::Impl {
 public:
     std::array<Cell, 0x800> cells{};
+    PeripheralStats* stats = nullptr;
     Impl() {
         for (std::size_t i = 0; i < cells.size(); ++i) {
             cells[i].index = (u16)i;
@@ -386,11 +388,21 @@ MMIORegion::MMIORegion(MemoryInterfaceUnit& miu, ICU& icu, Apbp& apbp_from_cpu,
 MMIORegion::~MMIORegion() = default;
 
 u16 MMIORegion::Read(u16 addr) {
+    if (impl->stats) {
+        ++impl->stats->mmio_reads[addr];
+    }
     u16 value = impl->cells[addr].get();
     return value;
 }
 void MMIORegion::Write(u16 addr, u16 value) {
+    if (impl->stats) {
+        ++impl->stats->mmio_writes[addr];
+    }
     impl->cells[addr].set(value);
 }
 
+void MMIORegion::SetStats(PeripheralStats* stats) {
+    impl->stats = stats;
+}
+
 } // namespace Teakra
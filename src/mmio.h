@@ -12,6 +12,7 @@ class Timer;
 class Dma;
 class Ahbm;
 class Btdmp;
+struct PeripheralStats;
 
 class MMIORegion {
 public:
@@ -20,6 +21,7 @@ public:
     ~MMIORegion();
     u16 Read(u16 addr); // not const because it can be a FIFO register
     void Write(u16 addr, u16 value);
+    void SetStats(PeripheralStats* stats);
 
 private:
     class Impl;
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#include <teakra/disassembler.h>
+#include <teakra/teakra.h>
+#include "../decoder.h"
+#include "../interpreter.h"
+#include "../jit_regs.h"
+#include "../processor.h"
+#include "../register.h"
+
+namespace {
+
+constexpr u16 IdleLoop = 0x57F0; // brr 0xffff always
+// Expansion word of every instruction: an address in plain data memory, away from MMIO, and an
+// unremarkable immediate
+constexpr u16 Expansion = 0x1000;
+constexpr u32 SequenceLength = 2048; // instructions per run
+constexpr u32 WarmupRuns = 8;        // compile, and leave a tiered JIT time to recompile
+
+// Forms that leave the straight line or change how the program runs
+const char* const ExcludedMnemonics[] = {
+    "br", "brr", "call", "calla", "callr", "ret", "retd", "reti", "retic", "retid", "retidc",
+    "rets", "rep", "bkrep", "bkreprst", "bkrepsto", "break", "trap", "dint", "eint", "cntx",
+};
+
+// Operands that would move the program counter, the stack or the data page, or enable interrupts
+const char* const ExcludedOperands[] = {
+    "pc", "prpage", "page", "sp", "lc", "repc", "icr", "mod3", "stt2", "ext0", "ext1", "ext2",
+    "ext3",
+};
+
+struct Form {
+    std::string identifier;
+    std::vector<u16> opcodes;
+};
+
+bool Benchmarkable(u16 opcode) {
+    const auto tokens = Teakra::Disassembler::GetTokenList(opcode);
+    const auto has = [&tokens](const char* name) {
+        return std::find(tokens.begin(), tokens.end(), name) != tokens.end();
+    };
+    return !tokens.empty() &&
+           std::none_of(std::begin(ExcludedMnemonics), std::end(ExcludedMnemonics),
+                        [&](const char* m) { return tokens.front() == m; }) &&
+           std::none_of(std::begin(ExcludedOperands), std::end(ExcludedOperands), has) &&
+           std::none_of(tokens.begin(), tokens.end(), [](const std::string& token) {
+               return token.find("[ERROR]") != std::string::npos;
+           });
+}
+
+// Groups the opcodes by the decode table entry that handles them, in table order
+std::vector<Form> GetForms() {
+    const auto table = GetDecoderTable<Teakra::Interpreter>();
+    std::vector<Form> forms;
+    std::map<std::string, std::size_t> index;
+    for (u32 opcode = 0; opcode < 0x10000; ++opcode) {
+        const auto& matcher = table[opcode];
+        if (std::strcmp(matcher.GetName(), "*") == 0 || !Benchmarkable(static_cast<u16>(opcode))) {
+            continue;
+        }
+        const auto [it, inserted] = index.emplace(matcher.GetIdentifier(), forms.size());
+        if (inserted) {
+            forms.push_back({matcher.GetIdentifier(), {}});
+        }
+        forms[it->second].opcodes.push_back(static_cast<u16>(opcode));
+    }
+    return forms;
+}
+
+void WriteProgram(Teakra::Teakra& teakra, const std::vector<u16>& program) {
+    std::memcpy(teakra.GetDspMemory().data(), program.data(), program.size() * sizeof(u16));
+}
+
+// The JIT aborts on instructions it doesn't implement and the interpreter throws, so try each
+// opcode on both in a child process and keep the ones that work. The child announces every opcode
+// before trying it, which tells the parent where to resume after a failure.
+std::vector<u16> Probe(const std::vector<u16>& candidates) {
+    std::vector<u16> supported;
+    std::size_t next = 0;
+    while (next < candidates.size()) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::perror("pipe");
+            std::exit(-1);
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            std::freopen("/dev/null", "w", stderr);
+            Teakra::Teakra interp(false);
+            Teakra::Teakra jit(true);
+            for (std::size_t i = next; i < candidates.size(); ++i) {
+                if (write(fds[1], &i, sizeof(i)) != sizeof(i)) {
+                    _exit(-1);
+                }
+                for (auto* teakra : {&interp, &jit}) {
+                    teakra->Reset();
+                    WriteProgram(*teakra, {candidates[i], Expansion, IdleLoop});
+                }
+                try {
+                    interp.Run(1);
+                } catch (const Teakra::UnimplementedException&) {
+                    _exit(1);
+                }
+                jit.Precompile(0);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+
+        std::size_t index;
+        std::size_t last = 0;
+        bool announced = false;
+        while (read(fds[0], &index, sizeof(index)) == sizeof(index)) {
+            if (announced) {
+                supported.push_back(candidates[last]);
+            }
+            last = index;
+            announced = true;
+        }
+        close(fds[0]);
+        int status;
+        waitpid(pid, &status, 0);
+        if (!announced) {
+            ++next;
+            continue;
+        }
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            supported.push_back(candidates[last]);
+        }
+        next = last + 1;
+    }
+    return supported;
+}
+
+// The form's opcodes in a fixed pseudo-random order, repeated up to SequenceLength instructions
+std::vector<u16> MakeSequence(std::vector<u16> opcodes) {
+    std::shuffle(opcodes.begin(), opcodes.end(), std::mt19937(SequenceLength));
+    std::vector<u16> program;
+    for (u32 i = 0; i < SequenceLength; ++i) {
+        const u16 opcode = opcodes[i % opcodes.size()];
+        program.push_back(opcode);
+        if (Teakra::Disassembler::NeedExpansion(opcode)) {
+            program.push_back(Expansion);
+        }
+    }
+    program.push_back(IdleLoop);
+    return program;
+}
+
+struct Timing {
+    double cycles; // host TSC ticks per instruction
+    double ns;
+};
+
+// Best of `repeats` runs of the sequence from reset registers. Memory is left as the previous run
+// left it.
+Timing Measure(Teakra::Teakra& teakra, bool use_jit, u32 repeats) {
+    auto& processor = teakra.GetProcessor();
+    const auto reset = [&] {
+        if (use_jit) {
+            processor.JitRegs().Reset();
+        } else {
+            processor.InterpRegs().Reset();
+        }
+    };
+    for (u32 i = 0; i < WarmupRuns; ++i) {
+        reset();
+        teakra.Run(SequenceLength);
+    }
+    u64 best_cycles = UINT64_MAX;
+    double best_ns = 0;
+    for (u32 i = 0; i < repeats; ++i) {
+        reset();
+        const auto start = std::chrono::steady_clock::now();
+        const u64 start_cycles = __rdtsc();
+        teakra.Run(SequenceLength);
+        const u64 cycles = __rdtsc() - start_cycles;
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (cycles < best_cycles) {
+            best_cycles = cycles;
+            best_ns = elapsed.count();
+        }
+    }
+    return {static_cast<double>(best_cycles) / SequenceLength, best_ns / SequenceLength};
+}
+
+struct Row {
+    const Form* form;
+    std::size_t supported;
+    Timing interp;
+    Timing jit;
+};
+
+Row Bench(const Form& form, const std::vector<u16>& supported, u32 repeats) {
+    const auto program = MakeSequence(supported);
+    Row row{&form, supported.size(), {}, {}};
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        teakra.SetAudioCallback([](std::array<s16, 2>) {});
+        Teakra::AHBMCallback ahbm;
+        ahbm.read8 = [](u32) -> u8 { return 0; };
+        ahbm.write8 = [](u32, u8) {};
+        ahbm.read16 = [](u32) -> u16 { return 0; };
+        ahbm.write16 = [](u32, u16) {};
+        ahbm.read32 = [](u32) -> u32 { return 0; };
+        ahbm.write32 = [](u32, u32) {};
+        teakra.SetAHBMCallback(ahbm);
+        teakra.Reset();
+        WriteProgram(teakra, program);
+        (use_jit ? row.jit : row.interp) = Measure(teakra, use_jit, repeats);
+    }
+    return row;
+}
+
+void Usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--repeat n] [--filter text] [--json results.json]\n"
+                 "  --repeat  timed runs per form and engine, the best is kept, default: 20\n"
+                 "  --filter  only forms whose name contains text, e.g. mac\n"
+                 "  --json    also write the table, to compare runs over time\n",
+                 program);
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    u32 repeats = 20;
+    const char* filter = nullptr;
+    const char* json_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeats = static_cast<u32>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+    if (repeats == 0) {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    std::vector<Row> rows;
+    std::vector<const Form*> unsupported;
+    const auto forms = GetForms();
+    for (const auto& form : forms) {
+        if (filter && form.identifier.find(filter) == std::string::npos) {
+            continue;
+        }
+        const auto supported = Probe(form.opcodes);
+        if (supported.empty()) {
+            unsupported.push_back(&form);
+            continue;
+        }
+        rows.push_back(Bench(form, supported, repeats));
+    }
+
+    // Slowest JIT code first
+    std::stable_sort(rows.begin(), rows.end(), [](const Row& lhs, const Row& rhs) {
+        return lhs.jit.cycles > rhs.jit.cycles;
+    });
+
+    std::printf("Host cycles (TSC) per DSP instruction, best of %u runs of %u instructions\n",
+                repeats, SequenceLength);
+    std::printf("%4s  %-24s %9s %10s %10s %8s %9s\n", "rank", "form", "opcodes", "interp",
+                "jit", "speedup", "jit ns");
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const Row& row = rows[i];
+        std::printf("%4zu  %-24s %4zu/%-4zu %10.1f %10.1f %8.1f %9.2f\n", i + 1,
+                    row.form->identifier.c_str(), row.supported, row.form->opcodes.size(),
+                    row.interp.cycles, row.jit.cycles, row.interp.cycles / row.jit.cycles,
+                    row.jit.ns);
+    }
+    if (!unsupported.empty()) {
+        std::printf("\nNot supported by both engines:");
+        for (const Form* form : unsupported) {
+            std::printf(" [%s]", form->identifier.c_str());
+        }
+        std::printf("\n");
+    }
+
+    if (json_path) {
+        std::FILE* json = std::fopen(json_path, "w");
+        if (!json) {
+            std::fprintf(stderr, "Unable to write %s\n", json_path);
+            return -2;
+        }
+        std::fprintf(json, "{\n  \"sequence_length\": %u,\n  \"repeats\": %u,\n  \"forms\": [",
+                     SequenceLength, repeats);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            const Row& row = rows[i];
+            std::fprintf(json,
+                         "%s\n    {\"form\": \"%s\", \"opcodes\": %zu, \"interp_cycles\": %.2f, "
+                         "\"jit_cycles\": %.2f, \"interp_ns\": %.3f, \"jit_ns\": %.3f}",
+                         i == 0 ? "" : ",", row.form->identifier.c_str(), row.supported,
+                         row.interp.cycles, row.jit.cycles, row.interp.ns, row.jit.ns);
+        }
+        std::fprintf(json, "\n  ]\n}\n");
+        std::fclose(json);
+    }
+    return 0;
+}
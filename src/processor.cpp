@@ -1,20 +1,127 @@
+#include <algorithm>
+#include <utility>
 #include <teakra/disassembler.h>
 #include "jit_no_ir.h"
+#include "lockstep.h"
 #include "processor.h"
+#include "profiler.h"
 #include "register.h"
 
 namespace Teakra {
 
 struct Processor::Impl {
     Impl(CoreTiming& core_timing, MemoryInterface& memory_interface, bool use_jit_)
-        : core_timing(core_timing), interpreter(core_timing, iregs, memory_interface),
+        : core_timing(core_timing), memory_interface(memory_interface),
+          interpreter(core_timing, iregs, memory_interface),
           jit(core_timing, regs, memory_interface), use_jit(use_jit_) {}
     CoreTiming& core_timing;
+    MemoryInterface& memory_interface;
     JitRegisters regs;
     RegisterState iregs;
     Interpreter interpreter;
     EmitX64 jit;
     bool use_jit;
+    Profiler profiler;
+    std::unique_ptr<LockstepVerifier> lockstep;
+    // With background compilation or tiering, set while the interpreter runs the JIT's state
+    bool interpreting = false;
+    // Set while the interpreter runs cold code for the tiered JIT
+    bool warming_up = false;
+
+    // Cycles the interpreter runs between checks for the compiled block
+    static constexpr s64 FallbackSlice = 512;
+
+    u32 RunWithFallback(s64 cycles) {
+        while (true) {
+            if (!interpreting) {
+                const u32 result = jit.Run(cycles);
+                if (!jit.compile_deferred && !jit.warmup_deferred) {
+                    return result;
+                }
+                cycles = result;
+                SwitchToInterpreter();
+                warming_up = jit.warmup_deferred;
+                if (jit.compile_deferred) {
+                    jit.QueueCompile();
+                }
+            }
+            if (!warming_up && !jit.CompilePending() && JitKnowsLoops()) {
+                SwitchToJit();
+                continue;
+            }
+            if (cycles <= 0) {
+                return 0;
+            }
+            const s64 slice = std::min(cycles, FallbackSlice);
+            if (warming_up) {
+                // Cold code only runs up to the next block, where the JIT counts the entry
+                cycles -= static_cast<s64>(interpreter.RunToBranch(static_cast<u64>(slice)));
+                warming_up = false;
+            } else {
+                interpreter.Run(static_cast<u64>(slice));
+                cycles -= slice;
+            }
+        }
+    }
+
+    // The JIT only loops back at the ends of the block repeats it has compiled, so the
+    // interpreter finishes the loops it started otherwise
+    bool JitKnowsLoops() const {
+        for (u16 i = 0; i < iregs.bcn; ++i) {
+            if (!jit.bkrep_end_locations.contains(iregs.bkrep_stack[i].end)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SwitchToInterpreter() {
+        ToRegisterState(regs, iregs);
+        interpreting = true;
+        // Only for the fallback, lockstep replays on this interpreter aren't traced
+        interpreter.tracer = jit.tracer;
+        for (u32 i = 0; i < jit.interrupt_pending.size(); ++i) {
+            if (std::exchange(jit.interrupt_pending[i], false)) {
+                interpreter.SignalInterrupt(i);
+            }
+        }
+        if (std::exchange(jit.vinterrupt_pending, false)) {
+            interpreter.SignalVectoredInterrupt(jit.vinterrupt_address,
+                                                jit.vinterrupt_context_switch);
+        }
+    }
+
+    void SwitchToJit() {
+        FromRegisterState(iregs, regs);
+        interpreting = false;
+        warming_up = false;
+        interpreter.tracer = nullptr;
+        for (u32 i = 0; i < interpreter.interrupt_pending.size(); ++i) {
+            if (interpreter.interrupt_pending[i].exchange(false)) {
+                jit.SignalInterrupt(i);
+            }
+        }
+        if (interpreter.vinterrupt_pending.exchange(false)) {
+            jit.SignalVectoredInterrupt(interpreter.vinterrupt_address,
+                                        interpreter.vinterrupt_context_switch);
+        }
+    }
+
+    // Hands the state back to the JIT right away, for the callers that need it there
+    void FinishFallback() {
+        if (!interpreting) {
+            return;
+        }
+        jit.WaitForCompile();
+        if (!JitKnowsLoops()) {
+            // Code compiled without knowing the loop ends would run past them
+            jit.ClearBlockCache();
+            for (u16 i = 0; i < iregs.bcn; ++i) {
+                jit.bkrep_end_locations.insert(iregs.bkrep_stack[i].end);
+            }
+        }
+        SwitchToJit();
+    }
 };
 
 Processor::Processor(CoreTiming& core_timing, MemoryInterface& memory_interface, bool use_jit)
@@ -24,6 +131,9 @@ Processor::~Processor() = default;
 
 void Processor::Reset() {
     if (impl->use_jit) {
+        impl->interpreting = false;
+        impl->warming_up = false;
+        impl->interpreter.tracer = nullptr;
         impl->jit.Reset();
     } else {
         impl->iregs.Reset();
@@ -32,14 +142,112 @@ void Processor::Reset() {
 
 u32 Processor::Run(unsigned cycles, Interpreter* debug_interp) {
     if (impl->use_jit) {
+        if (debug_interp &&
+            (!impl->lockstep || &impl->lockstep->GetInterpreter() != debug_interp)) {
+            impl->lockstep =
+                std::make_unique<LockstepVerifier>(*debug_interp, impl->memory_interface);
+        }
+        impl->jit.lockstep = debug_interp ? impl->lockstep.get() : nullptr;
+        if (debug_interp) {
+            // Lockstep verification replays blocks on the same interpreter
+            impl->FinishFallback();
+        }
+        if (impl->jit.compile_thread.joinable() || impl->jit.tiered) {
+            return impl->RunWithFallback(cycles);
+        }
         return impl->jit.Run(cycles);
     } else {
         return impl->interpreter.Run(cycles);
     }
 }
 
-void Processor::SignalInterrupt(u32 i) {
+std::string Processor::GetLockstepReport() const {
+    return impl->lockstep ? impl->lockstep->Report() : std::string{};
+}
+
+void Processor::ResetLockstep() {
+    impl->jit.lockstep = nullptr;
+    impl->lockstep.reset();
+}
+
+void Processor::Precompile(u32 pc) {
+    if (impl->use_jit) {
+        impl->jit.Precompile(pc);
+    }
+}
+
+void Processor::SetTieredCompilation(bool enabled) {
+    if (impl->use_jit) {
+        impl->FinishFallback();
+        impl->jit.SetTiered(enabled);
+    }
+}
+
+void Processor::SetBackgroundCompilation(bool enabled) {
+    if (impl->use_jit) {
+        if (!enabled) {
+            impl->FinishFallback();
+        }
+        impl->jit.SetBackgroundCompilation(enabled);
+    }
+}
+
+void Processor::SetPerfMap(bool enabled) {
+    if (impl->use_jit) {
+        impl->jit.SetPerfMap(enabled);
+    }
+}
+
+JitStats Processor::GetJitStats(std::size_t top_n) const {
+    if (impl->use_jit) {
+        return impl->jit.GetStats(top_n);
+    }
+    return {};
+}
+
+void Processor::StartProfiler(u32 interval) {
+    impl->profiler.Start(interval);
+    impl->interpreter.profiler = &impl->profiler;
+    impl->jit.profiler = &impl->profiler;
+}
+
+void Processor::StopProfiler() {
+    impl->profiler.Stop();
+    impl->interpreter.profiler = nullptr;
+    impl->jit.profiler = nullptr;
+}
+
+const Profiler& Processor::GetProfiler() const {
+    return impl->profiler;
+}
+
+void Processor::SetTracer(Tracer* tracer) {
+    if (impl->use_jit) {
+        impl->jit.tracer = tracer;
+        if (impl->interpreting) {
+            impl->interpreter.tracer = tracer;
+        }
+    } else {
+        impl->interpreter.tracer = tracer;
+    }
+}
+
+std::vector<u8> Processor::SaveBlockList() {
+    if (impl->use_jit) {
+        return impl->jit.SaveBlockList();
+    }
+    return {};
+}
+
+bool Processor::LoadBlockList(std::span<const u8> data) {
     if (impl->use_jit) {
+        return impl->jit.LoadBlockList(data);
+    }
+    return false;
+}
+
+void Processor::SignalInterrupt(u32 i) {
+    if (impl->use_jit && !impl->interpreting) {
         impl->jit.SignalInterrupt(i);
     } else {
         impl->interpreter.SignalInterrupt(i);
@@ -47,7 +255,7 @@ void Processor::SignalInterrupt(u32 i) {
 }
 
 void Processor::SignalVectoredInterrupt(u32 address, bool context_switch) {
-    if (impl->use_jit) {
+    if (impl->use_jit && !impl->interpreting) {
         impl->jit.SignalVectoredInterrupt(address, context_switch);
     } else {
         impl->interpreter.SignalVectoredInterrupt(address, context_switch);
@@ -58,4 +266,12 @@ Interpreter& Processor::Interp() {
     return impl->interpreter;
 }
 
+RegisterState& Processor::InterpRegs() {
+    return impl->iregs;
+}
+
+JitRegisters& Processor::JitRegs() {
+    return impl->regs;
+}
+
 } // namespace Teakra
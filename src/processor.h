@@ -1,6 +1,10 @@
 #pragma once
 
 #include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <teakra/teakra.h>
 #include "common_types.h"
 #include "core_timing.h"
 
@@ -8,16 +12,43 @@ namespace Teakra {
 
 class MemoryInterface;
 class Interpreter;
+class LockstepVerifier;
+class Profiler;
+class Tracer;
+struct RegisterState;
+struct JitRegisters;
 
 class Processor {
 public:
     Processor(CoreTiming& core_timing, MemoryInterface& memory_interface, bool use_jit);
     ~Processor();
     void Reset();
+    // With the JIT and a `debug_interp` running on the same memory interface, every block is
+    // replayed on debug_interp and checked, see LockstepVerifier
     u32 Run(u32 cycles, Interpreter* debug_interp);
+    // Empty until lockstep verification finds a divergence. Resetting drops the report.
+    std::string GetLockstepReport() const;
+    void ResetLockstep();
+    void Precompile(u32 pc);
+    void SetTieredCompilation(bool enabled);
+    // Misses are compiled on a thread while the interpreter runs the code, see
+    // Teakra::SetBackgroundCompilation
+    void SetBackgroundCompilation(bool enabled);
+    void SetPerfMap(bool enabled);
+    JitStats GetJitStats(std::size_t top_n) const;
+    void StartProfiler(u32 interval);
+    void StopProfiler();
+    const Profiler& GetProfiler() const;
+    // Null to stop tracing
+    void SetTracer(Tracer* tracer);
+    std::vector<u8> SaveBlockList();
+    bool LoadBlockList(std::span<const u8> data);
     void SignalInterrupt(u32 i);
     void SignalVectoredInterrupt(u32 address, bool context_switch);
     Interpreter& Interp();
+    // Register state of each engine, for tools that set up and compare states directly
+    RegisterState& InterpRegs();
+    JitRegisters& JitRegs();
 
 private:
     struct Impl;
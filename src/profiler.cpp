@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <teakra/disassembler.h>
+#include "profiler.h"
+
+namespace Teakra {
+
+void Profiler::Start(u32 interval_) {
+    entries.clear();
+    interval = std::max<u32>(interval_, 1);
+    pending_cycles = 0;
+    last_sample = std::chrono::steady_clock::now();
+    running = true;
+}
+
+void Profiler::Stop() {
+    running = false;
+}
+
+void Profiler::Sample(u32 pc) {
+    const auto now = std::chrono::steady_clock::now();
+    Entry& entry = entries[pc];
+    entry.samples++;
+    entry.cycles += pending_cycles;
+    entry.host_time += now - last_sample;
+    pending_cycles = 0;
+    last_sample = now;
+}
+
+std::string Profiler::Report(const std::function<u16(u32)>& program_read,
+                             std::size_t top_n) const {
+    std::vector<std::pair<u32, const Entry*>> sorted;
+    u64 total_cycles = 0;
+    std::chrono::steady_clock::duration total_time{};
+    for (const auto& [pc, entry] : entries) {
+        sorted.emplace_back(pc, &entry);
+        total_cycles += entry.cycles;
+        total_time += entry.host_time;
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second->host_time > rhs.second->host_time;
+    });
+    sorted.resize(std::min(top_n, sorted.size()));
+
+    const auto to_us = [](std::chrono::steady_clock::duration time) {
+        return static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(time).count());
+    };
+    const auto percent = [](double part, double total) {
+        return total == 0 ? 0.0 : 100.0 * part / total;
+    };
+
+    std::string result;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%llu cycles, %llu us host time\n",
+                  static_cast<unsigned long long>(total_cycles), to_us(total_time));
+    result += line;
+    result += "     pc  samples     cycles(%)     host us(%)  instruction\n";
+    for (const auto& [pc, entry] : sorted) {
+        const u16 opcode = program_read(pc);
+        const u16 expansion =
+            Disassembler::NeedExpansion(opcode) ? program_read((pc + 1) & 0x3FFFF) : 0;
+        std::snprintf(line, sizeof(line), "%05X %8llu %10llu(%5.1f) %10llu(%5.1f)  %s\n", pc,
+                      static_cast<unsigned long long>(entry->samples),
+                      static_cast<unsigned long long>(entry->cycles),
+                      percent(static_cast<double>(entry->cycles),
+                              static_cast<double>(total_cycles)),
+                      to_us(entry->host_time),
+                      percent(static_cast<double>(entry->host_time.count()),
+                              static_cast<double>(total_time.count())),
+                      Disassembler::Do(opcode, expansion).c_str());
+        result += line;
+    }
+    return result;
+}
+
+} // namespace Teakra
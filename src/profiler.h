@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "common_types.h"
+
+namespace Teakra {
+
+/// Statistical DSP profiler. The cores report the emulated cycles they run together with the
+/// program counter; every `interval` cycles the current PC takes a sample and is charged with
+/// the emulated cycles and host time elapsed since the previous sample.
+class Profiler {
+public:
+    /// Discards the samples of any previous run.
+    void Start(u32 interval);
+    void Stop();
+
+    bool IsRunning() const {
+        return running;
+    }
+
+    void Advance(u32 pc, u64 cycles) {
+        pending_cycles += cycles;
+        if (pending_cycles >= interval) {
+            Sample(pc);
+        }
+    }
+
+    /// Lists the top_n program counters by host time, disassembling the instruction at each.
+    std::string Report(const std::function<u16(u32)>& program_read, std::size_t top_n) const;
+
+private:
+    struct Entry {
+        u64 samples = 0;
+        u64 cycles = 0;
+        std::chrono::steady_clock::duration host_time{};
+    };
+
+    void Sample(u32 pc);
+
+    bool running = false;
+    u32 interval = 1;
+    u64 pending_cycles = 0;
+    std::chrono::steady_clock::time_point last_sample;
+    std::unordered_map<u32, Entry> entries;
+};
+
+} // namespace Teakra
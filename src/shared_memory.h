@@ -1,6 +1,9 @@
 #pragma once
 #include <array>
+#include <bit>
 #include <cstdio>
+#include <cstring>
+#include <span>
 #include "common_types.h"
 
 namespace Teakra {
@@ -19,5 +22,32 @@ struct SharedMemory {
         raw[byte_address] = low;
         raw[byte_address + 1] = high;
     }
+    // The block transfers return false, without transferring anything, if the range doesn't fit
+    bool ReadWords(u32 word_address, std::span<u16> out) const {
+        if (u64{word_address} * 2 + out.size_bytes() > raw.size()) {
+            return false;
+        }
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(out.data(), raw.data() + word_address * 2, out.size_bytes());
+        } else {
+            for (std::size_t i = 0; i < out.size(); ++i) {
+                out[i] = ReadWord(word_address + static_cast<u32>(i));
+            }
+        }
+        return true;
+    }
+    bool WriteWords(u32 word_address, std::span<const u16> data) {
+        if (u64{word_address} * 2 + data.size_bytes() > raw.size()) {
+            return false;
+        }
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(raw.data() + word_address * 2, data.data(), data.size_bytes());
+        } else {
+            for (std::size_t i = 0; i < data.size(); ++i) {
+                WriteWord(word_address + static_cast<u32>(i), data[i]);
+            }
+        }
+        return true;
+    }
 };
 } // namespace Teakra
@@ -1,4 +1,9 @@
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
 #include <teakra/teakra.h>
 #include "ahbm.h"
 #include "apbp.h"
@@ -9,11 +14,41 @@
 #include "memory_interface.h"
 #include "mmio.h"
 #include "processor.h"
+#include "profiler.h"
 #include "shared_memory.h"
 #include "timer.h"
+#include "trace.h"
 
 namespace Teakra {
 
+namespace {
+struct Dsp1Header {
+    u8 signature[0x100];
+    u8 magic[4];
+    u32 binary_size;
+    u16 memory_layout;
+    u16 padding;
+    u8 unknown;
+    u8 filter_segment_type;
+    u8 num_segments;
+    u8 flags;
+    u32 filter_segment_address;
+    u32 filter_segment_size;
+    u64 zero;
+    struct Segment {
+        u32 offset;
+        u32 address;
+        u32 size;
+        u8 pa, pb, pc;
+        u8 memory_type;
+        u8 sha256[0x20];
+    } segments[10];
+};
+static_assert(sizeof(Dsp1Header) == 0x300);
+
+constexpr u32 Dsp1DataOffset = MemoryInterfaceUnit::DataMemoryOffset * sizeof(u16);
+} // Anonymous namespace
+
 struct Teakra::Impl {
     std::array<Timer, 2> timer{};
     std::array<Btdmp, 2> btdmp{};
@@ -27,6 +62,9 @@ struct Teakra::Impl {
     MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
     MemoryInterface memory_interface{shared_memory, miu, mmio};
     Processor processor;
+    PeripheralStats peripheral_stats{};
+    Tracer tracer;
+    bool lockstep = false;
 
     Impl(bool use_jit) : processor(core_timing, memory_interface, use_jit) {
         using namespace std::placeholders;
@@ -48,7 +86,6 @@ struct Teakra::Impl {
     }
 
     void Reset() {
-        shared_memory.raw.fill(0);
         miu.Reset();
         apbp_from_cpu.Reset();
         apbp_from_dsp.Reset();
@@ -58,7 +95,9 @@ struct Teakra::Impl {
         dma.Reset();
         btdmp[0].Reset();
         btdmp[1].Reset();
+        // The JIT fingerprints the outgoing program image on reset, so clear memory afterwards
         processor.Reset();
+        shared_memory.raw.fill(0);
     }
 };
 
@@ -89,7 +128,162 @@ const std::array<std::uint8_t, 0x80000>& Teakra::GetDspMemory() const {
 }
 
 u32 Teakra::Run(unsigned cycle) {
-    return impl->processor.Run(cycle, &impl_interp->processor.Interp());
+    return impl->processor.Run(cycle, impl->lockstep ? &impl->processor.Interp() : nullptr);
+}
+
+std::optional<Dsp1Info> Teakra::LoadDsp1(std::span<const std::uint8_t> image, bool precompile) {
+    Dsp1Header header;
+    if (image.size() < sizeof(header)) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.magic, "DSP1", 4) != 0 || header.num_segments > 10) {
+        return std::nullopt;
+    }
+
+    // Validate everything before touching memory
+    for (u32 i = 0; i < header.num_segments; ++i) {
+        const auto& segment = header.segments[i];
+        if (segment.memory_type > 2 || u64{segment.offset} + segment.size > image.size() ||
+            u64{segment.address} * 2 + segment.size > Dsp1DataOffset) {
+            return std::nullopt;
+        }
+    }
+
+    auto& raw = impl->shared_memory.raw;
+    for (u32 i = 0; i < header.num_segments; ++i) {
+        const auto& segment = header.segments[i];
+        // Types 0 and 1 are program memory, type 2 is data memory
+        const u32 base = segment.memory_type == 2 ? Dsp1DataOffset : 0;
+        std::memcpy(raw.data() + base + segment.address * 2, image.data() + segment.offset,
+                    segment.size);
+    }
+
+    if (precompile) {
+        impl->processor.Precompile(0);
+    }
+
+    return Dsp1Info{header.memory_layout, (header.flags & 1) != 0};
+}
+
+void Teakra::Precompile(std::uint32_t address) {
+    impl->processor.Precompile(address);
+}
+
+void Teakra::SetTieredCompilation(bool enabled) {
+    impl->processor.SetTieredCompilation(enabled);
+}
+
+void Teakra::SetBackgroundCompilation(bool enabled) {
+    impl->processor.SetBackgroundCompilation(enabled);
+}
+
+void Teakra::StartProfiler(std::uint32_t sample_interval) {
+    impl->processor.StartProfiler(sample_interval);
+}
+
+void Teakra::StopProfiler() {
+    impl->processor.StopProfiler();
+}
+
+std::string Teakra::GetProfilerReport(std::size_t top_n) const {
+    return impl->processor.GetProfiler().Report(
+        [this](u32 address) { return impl->memory_interface.ProgramRead(address); }, top_n);
+}
+
+void Teakra::SetLockstepVerification(bool enabled) {
+    impl->processor.ResetLockstep();
+    impl->lockstep = enabled;
+}
+
+std::string Teakra::GetLockstepReport() const {
+    return impl->processor.GetLockstepReport();
+}
+
+JitStats Teakra::GetJitStats(std::size_t top_n) const {
+    return impl->processor.GetJitStats(top_n);
+}
+
+void Teakra::StartTrace(std::size_t capacity, const std::string& crash_path) {
+    const std::span<const u8> program{impl->shared_memory.raw.data(),
+                                      MemoryInterfaceUnit::DataMemoryOffset * sizeof(u16)};
+    impl->tracer.Start(capacity, program, crash_path);
+    Tracer* tracer = &impl->tracer;
+    impl->processor.SetTracer(tracer);
+    impl->memory_interface.tracer = tracer;
+    impl->dma.tracer = tracer;
+    impl->btdmp[0].SetTracer(tracer, 0);
+    impl->btdmp[1].SetTracer(tracer, 1);
+}
+
+void Teakra::StopTrace() {
+    impl->tracer.Stop();
+    impl->processor.SetTracer(nullptr);
+    impl->memory_interface.tracer = nullptr;
+    impl->dma.tracer = nullptr;
+    impl->btdmp[0].SetTracer(nullptr, 0);
+    impl->btdmp[1].SetTracer(nullptr, 1);
+}
+
+bool Teakra::WriteTrace(const std::string& path) const {
+    return impl->tracer.Write(path);
+}
+
+void Teakra::SetPeripheralStats(bool enabled) {
+    PeripheralStats* stats = nullptr;
+    if (enabled) {
+        impl->peripheral_stats = {};
+        stats = &impl->peripheral_stats;
+    }
+    impl->mmio.SetStats(stats);
+    impl->dma.stats = stats;
+    impl->ahbm.stats = stats;
+    impl->icu.SetStats(stats);
+}
+
+PeripheralStats Teakra::GetPeripheralStats() const {
+    return impl->peripheral_stats;
+}
+
+void Teakra::SetJitPerfMap(bool enabled) {
+    impl->processor.SetPerfMap(enabled);
+}
+
+bool Teakra::SavePrecompileList(const std::string& path) {
+    if (!use_jit) {
+        return false;
+    }
+    const std::vector<u8> data = impl->processor.SaveBlockList();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    return file.good();
+}
+
+bool Teakra::LoadPrecompileList(const std::string& path) {
+    if (!use_jit) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    const std::vector<u8> data{std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>()};
+    return impl->processor.LoadBlockList(data);
+}
+
+u32 Teakra::RunUntil(u32 max_cycle, u32 slice, const std::function<bool()>& predicate) {
+    if (slice == 0) {
+        slice = max_cycle;
+    }
+    u32 elapsed = 0;
+    while (elapsed < max_cycle && !predicate()) {
+        const u32 step = std::min(slice, max_cycle - elapsed);
+        Run(step);
+        elapsed += step;
+    }
+    return elapsed;
 }
 
 bool Teakra::SendDataIsEmpty(std::uint8_t index) const {
@@ -159,6 +353,11 @@ void Teakra::SetAudioCallback(std::function<void(std::array<s16, 2>)> callback)
     impl->btdmp[0].SetAudioCallback(callback);
 }
 
+void Teakra::SetAudioBlockCallback(std::size_t frames,
+                                   std::function<void(std::span<const s16>)> callback) {
+    impl->btdmp[0].SetAudioBlockCallback(frames, std::move(callback));
+}
+
 std::uint16_t Teakra::ProgramRead(std::uint32_t address) const {
     return impl->memory_interface.ProgramRead(address);
 }
@@ -184,6 +383,19 @@ void Teakra::MMIOWrite(std::uint16_t address, std::uint16_t value) {
     impl->memory_interface.MMIOWrite(address, value);
 }
 
+bool Teakra::ProgramReadBlock(std::uint32_t address, std::span<std::uint16_t> out) const {
+    return impl->memory_interface.ProgramReadBlock(address, out);
+}
+bool Teakra::ProgramWriteBlock(std::uint32_t address, std::span<const std::uint16_t> data) {
+    return impl->memory_interface.ProgramWriteBlock(address, data);
+}
+void Teakra::DataReadBlock(std::uint32_t address, std::span<std::uint16_t> out) const {
+    impl->memory_interface.DataReadA32Block(address, out);
+}
+void Teakra::DataWriteBlock(std::uint32_t address, std::span<const std::uint16_t> data) {
+    impl->memory_interface.DataWriteA32Block(address, data);
+}
+
 std::uint16_t Teakra::DMAChan0GetSrcHigh() {
     u16 active_bak = impl->dma.GetActiveChannel();
     impl->dma.ActivateChannel(0);
@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <teakra/disassembler.h>
+#include <teakra/teakra.h>
+#include "../common_types.h"
+
+namespace {
+
+constexpr u32 ProgramWords = 0x20000;
+constexpr u32 NumInterruptVectors = 3;
+
+bool IsJump(const std::string& op) {
+    return op == "br" || op == "brr";
+}
+
+bool IsCall(const std::string& op) {
+    return op == "call" || op == "callr";
+}
+
+bool IsReturn(const std::string& op) {
+    return op == "ret" || op == "reti" || op == "retic" || op == "rets" || op == "retd" ||
+           op == "retid" || op == "retidc";
+}
+
+// Follows direct control flow from the entry points and returns every address a block can start
+// at: entry points, branch and call targets, and the instructions after branches and calls.
+// Indirect jumps (calla, writes to pc) end a path since their targets are unknown.
+std::set<u32> DiscoverBlockStarts(const Teakra::Teakra& teakra, const std::vector<u32>& entries) {
+    std::set<u32> starts(entries.begin(), entries.end());
+    std::set<u32> visited;
+    std::deque<u32> worklist(entries.begin(), entries.end());
+
+    const auto add_start = [&](u32 address) {
+        address %= ProgramWords;
+        starts.insert(address);
+        worklist.push_back(address);
+    };
+
+    while (!worklist.empty()) {
+        u32 pc = worklist.front();
+        worklist.pop_front();
+        while (visited.insert(pc).second) {
+            const u16 opcode = teakra.ProgramRead(pc);
+            u16 expansion = 0;
+            u32 next = pc + 1;
+            if (Teakra::Disassembler::NeedExpansion(opcode)) {
+                expansion = teakra.ProgramRead(next % ProgramWords);
+                next++;
+            }
+            next %= ProgramWords;
+
+            const auto tokens = Teakra::Disassembler::GetTokenList(opcode, expansion);
+            const std::string& op = tokens.front();
+            if (op == "[ERROR]") {
+                break;
+            }
+            const bool always = tokens.back() == "always";
+
+            if (op == "br" || op == "call") {
+                add_start(static_cast<u32>(std::stoul(tokens[1], nullptr, 16)));
+            } else if (op == "brr" || op == "callr") {
+                const auto offset = static_cast<s16>(std::stoul(tokens[1], nullptr, 16));
+                add_start(next + offset);
+            }
+
+            if (IsJump(op) || IsCall(op) || IsReturn(op)) {
+                if ((IsJump(op) || op == "ret" || op == "reti" || op == "retic") && always) {
+                    break;
+                }
+                if (op == "rets" || op == "retd" || op == "retid" || op == "retidc") {
+                    break;
+                }
+                add_start(next);
+                break;
+            }
+            if (op == "calla" || op == "mov p->pc" || tokens.back() == "pc") {
+                break;
+            }
+            pc = next;
+        }
+    }
+    return starts;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <dsp1 image> <precompile list> [boot cycles]\n", argv[0]);
+        return -1;
+    }
+
+    FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return -1;
+    }
+    std::vector<u8> image;
+    u8 buffer[4096];
+    std::size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) != 0) {
+        image.insert(image.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+
+    Teakra::Teakra teakra(true);
+    // The firmware may touch external memory while booting, give it something to talk to
+    std::vector<u8> fcram(0x1000000);
+    Teakra::AHBMCallback ahbm;
+    ahbm.read8 = [&](u32 address) -> u8 { return fcram[address % fcram.size()]; };
+    ahbm.write8 = [&](u32 address, u8 value) { fcram[address % fcram.size()] = value; };
+    ahbm.read16 = [](u32) -> u16 { return 0; };
+    ahbm.write16 = [](u32, u16) {};
+    ahbm.read32 = [](u32) -> u32 { return 0; };
+    ahbm.write32 = [](u32, u32) {};
+    teakra.SetAHBMCallback(ahbm);
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+
+    if (!teakra.LoadDsp1(image)) {
+        std::fprintf(stderr, "%s is not a valid DSP1 image\n", argv[1]);
+        return -1;
+    }
+
+    // Running the boot code compiles it with the register state it really has, and leaves the
+    // mode registers as the firmware configured them for the blocks compiled below.
+    if (argc > 3) {
+        const u32 boot_cycles = static_cast<u32>(std::strtoul(argv[3], nullptr, 0));
+        teakra.Run(boot_cycles);
+    }
+
+    std::vector<u32> entries{0};
+    for (u32 i = 0; i < NumInterruptVectors; ++i) {
+        entries.push_back(0x0006 + i * 8);
+    }
+    const auto starts = DiscoverBlockStarts(teakra, entries);
+    for (const u32 pc : starts) {
+        teakra.Precompile(pc);
+    }
+    std::printf("Compiled %zu block entries\n", starts.size());
+
+    if (!teakra.SavePrecompileList(argv[2])) {
+        std::fprintf(stderr, "cannot write %s\n", argv[2]);
+        return -1;
+    }
+    return 0;
+}
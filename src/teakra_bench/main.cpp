@@ -0,0 +1,268 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <teakra/teakra.h>
+#include "../common_types.h"
+#include "../parser.h"
+
+namespace {
+
+constexpr u32 DataOffset = 0x40000; // byte offset of data memory in the DSP memory image
+constexpr u32 Slice = 16384;        // cycles per Run call, like a frontend would use
+
+// Every kernel starts with this: it sets up the stack, jumps to `start`, and places an interrupt 0
+// handler at its vector (0x0006)
+constexpr char Header[] = R"(
+    mov 0x$7000 sp
+    br 0x0000$start always
+    nop
+    nop
+    reti always
+)";
+
+struct Kernel {
+    const char* name;
+    const char* source;
+};
+
+const Kernel Kernels[] = {
+    {"mac", R"(
+    start:
+        mov 0x$0003 y0
+    loop:
+        mov 0x$1000 r0
+        clr a0 always
+        bkrep 0x0007u8 0x0000$loop_end
+        rep 0x001fu8
+        mac y0 [r0++] a0
+    loop_end:
+        mac y0 [r0++] a0
+        br 0x0000$loop always
+    )"},
+    {"copy", R"(
+    start:
+        mov 0x$1000 r0
+        mov 0x$2000 r1
+        bkrep 0x00ffu8 0x0000$copy_end
+        mov [r0++] a0l
+    copy_end:
+        mov a0l [r1++]
+        br 0x0000$start always
+    )"},
+    // Reads the APBP status register like firmware waiting for a command. The counter keeps the
+    // loop from being detected as idle.
+    {"mmio_poll", R"(
+    start:
+        mov [0x$80d6] a0
+        add 0x$0001 a1
+        br 0x0000$start always
+    )"},
+    // Data memory to data memory transfers of 256 words, restarted back to back
+    {"dma", R"(
+    start:
+        mov 0x$0000 a0l
+        mov a0l [0x$81be]
+        mov a0l [0x$81c2]
+        mov a0l [0x$81c6]
+        mov a0l [0x$81da]
+        mov 0x$1000 a0l
+        mov a0l [0x$81c0]
+        mov 0x$2000 a0l
+        mov a0l [0x$81c4]
+        mov 0x$0100 a0l
+        mov a0l [0x$81c8]
+        mov 0x$0001 a0l
+        mov a0l [0x$81ca]
+        mov a0l [0x$81cc]
+        mov a0l [0x$81ce]
+        mov a0l [0x$81d0]
+        mov 0x$40c0 a0l
+    loop:
+        mov a0l [0x$81de]
+        add 0x$0001 a1
+        br 0x0000$loop always
+    )"},
+    // Raises IRQ 0, routed to interrupt 0, on every iteration
+    {"interrupts", R"(
+    start:
+        mov 0x$0001 a0l
+        mov a0l [0x$8206]
+        mov 0x$0180 mod3
+    loop:
+        mov a0l [0x$8204]
+        add 0x$0001 a1
+        br 0x0000$loop always
+    )"},
+    {"idle", R"(
+    start:
+        brr 0xffff always
+    )"},
+};
+
+std::vector<std::string> StringToTokens(const std::string& in) {
+    std::vector<std::string> out;
+    bool need_new = true;
+    for (char c : in) {
+        if (c == ' ' || c == '\t') {
+            need_new = true;
+        } else {
+            if (need_new) {
+                need_new = false;
+                out.push_back("");
+            }
+            out.back() += c;
+        }
+    }
+    return out;
+}
+
+// Same syntax as makedsp1: one instruction per line as the disassembler prints it, with the
+// expansion word written as `$xxxx` in place of four of its digits. `name:` defines a label, and
+// `$name` uses its address as the expansion word.
+std::vector<u16> Assemble(Teakra::Parser& parser, const std::string& source) {
+    struct Fixup {
+        std::size_t index;
+        std::string label;
+    };
+    std::vector<u16> program;
+    std::map<std::string, u16> labels;
+    std::vector<Fixup> fixups;
+
+    std::size_t begin = 0;
+    while (begin < source.size()) {
+        std::size_t end = source.find('\n', begin);
+        if (end == std::string::npos) {
+            end = source.size();
+        }
+        std::string line = source.substr(begin, end - begin);
+        begin = end + 1;
+
+        auto comment_pos = line.find("//");
+        if (comment_pos != std::string::npos) {
+            line.erase(comment_pos);
+        }
+
+        std::string expansion;
+        auto expansion_pos = line.find('$');
+        if (expansion_pos != std::string::npos) {
+            auto expansion_end = line.find_first_of(" \t]", expansion_pos);
+            if (expansion_end == std::string::npos) {
+                expansion_end = line.size();
+            }
+            expansion = line.substr(expansion_pos + 1, expansion_end - expansion_pos - 1);
+            line = line.substr(0, expansion_pos) + "0000" + line.substr(expansion_end);
+        }
+
+        auto tokens = StringToTokens(line);
+        if (tokens.empty()) {
+            continue;
+        }
+        if (tokens.size() == 1 && tokens[0].back() == ':') {
+            tokens[0].pop_back();
+            labels[tokens[0]] = static_cast<u16>(program.size());
+            continue;
+        }
+
+        auto opcode = parser.Parse(tokens);
+        if (opcode.status == Teakra::Parser::Opcode::Invalid) {
+            std::fprintf(stderr, "could not parse: %s\n", line.c_str());
+            std::exit(-1);
+        }
+        program.push_back(opcode.opcode);
+        if ((opcode.status == Teakra::Parser::Opcode::ValidWithExpansion) != !expansion.empty()) {
+            std::fprintf(stderr, "wrong expansion: %s\n", line.c_str());
+            std::exit(-1);
+        }
+        if (!expansion.empty()) {
+            char* number_end;
+            const auto value = std::strtoul(expansion.c_str(), &number_end, 16);
+            if (*number_end == '\0') {
+                program.push_back(static_cast<u16>(value));
+            } else {
+                fixups.push_back({program.size(), expansion});
+                program.push_back(0);
+            }
+        }
+    }
+
+    for (const auto& fixup : fixups) {
+        auto label = labels.find(fixup.label);
+        if (label == labels.end()) {
+            std::fprintf(stderr, "unknown label: %s\n", fixup.label.c_str());
+            std::exit(-1);
+        }
+        program[fixup.index] = label->second;
+    }
+    return program;
+}
+
+struct Result {
+    double mhz;
+    double ns_per_cycle;
+};
+
+Result RunKernel(const std::vector<u16>& program, bool use_jit, u32 cycles) {
+    Teakra::Teakra teakra(use_jit);
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+
+    auto& memory = teakra.GetDspMemory();
+    std::memcpy(memory.data(), program.data(), program.size() * sizeof(u16));
+    // Source data for the mac, copy and dma kernels
+    for (u32 i = 0; i < 0x1000; ++i) {
+        const u16 value = static_cast<u16>(i * 0x9E37);
+        std::memcpy(memory.data() + DataOffset + (0x1000 + i) * 2, &value, sizeof(u16));
+    }
+
+    // Keep compilation and first touches out of the measurement
+    for (u32 warmup = 0; warmup < cycles / 10; warmup += Slice) {
+        teakra.Run(Slice);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    u64 ran = 0;
+    while (ran < cycles) {
+        ran += teakra.Run(Slice);
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return {static_cast<double>(ran) / elapsed.count() * 1000.0,
+            elapsed.count() / static_cast<double>(ran)};
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    u32 cycles = 20'000'000;
+    if (argc > 1) {
+        cycles = static_cast<u32>(std::strtoul(argv[1], nullptr, 0));
+    }
+    const char* filter = argc > 2 ? argv[2] : nullptr;
+    if (cycles == 0) {
+        std::fprintf(stderr, "usage: %s [cycles] [kernel]\n", argv[0]);
+        return -1;
+    }
+
+    auto parser = Teakra::GenerateParser();
+
+    // The emulator retires one instruction per cycle, so ns/cycle is also ns/instruction, except
+    // for cycles skipped while idle
+    std::printf("%-12s %-12s %10s %12s\n", "kernel", "engine", "MHz", "ns/insn");
+    for (const auto& kernel : Kernels) {
+        if (filter && std::strcmp(filter, kernel.name) != 0) {
+            continue;
+        }
+        const auto program = Assemble(*parser, std::string(Header) + kernel.source);
+        for (const bool use_jit : {false, true}) {
+            const auto result = RunKernel(program, use_jit, cycles);
+            std::printf("%-12s %-12s %10.2f %12.3f\n", kernel.name,
+                        use_jit ? "jit" : "interpreter", result.mhz, result.ns_per_cycle);
+        }
+    }
+    return 0;
+}
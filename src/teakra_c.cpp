@@ -91,6 +91,22 @@ void Teakra_MMIOWrite(TeakraContext* context, uint16_t address, uint16_t value)
     context->teakra.MMIOWrite(address, value);
 }
 
+bool Teakra_ProgramReadBlock(TeakraContext* context, uint32_t address, uint16_t* out,
+                             size_t count) {
+    return context->teakra.ProgramReadBlock(address, {out, count});
+}
+bool Teakra_ProgramWriteBlock(TeakraContext* context, uint32_t address, const uint16_t* data,
+                              size_t count) {
+    return context->teakra.ProgramWriteBlock(address, {data, count});
+}
+void Teakra_DataReadBlock(TeakraContext* context, uint32_t address, uint16_t* out, size_t count) {
+    context->teakra.DataReadBlock(address, {out, count});
+}
+void Teakra_DataWriteBlock(TeakraContext* context, uint32_t address, const uint16_t* data,
+                           size_t count) {
+    context->teakra.DataWriteBlock(address, {data, count});
+}
+
 uint16_t Teakra_DMAChan0GetSrcHigh(TeakraContext* context) {
     return context->teakra.DMAChan0GetSrcHigh();
 }
@@ -121,10 +137,29 @@ void Teakra_AHBMWrite32(TeakraContext* context, uint32_t addr, uint32_t value) {
     context->teakra.AHBMWrite32(addr, value);
 }
 
+bool Teakra_LoadDsp1(TeakraContext* context, const uint8_t* image, size_t size, bool precompile,
+                     Teakra_Dsp1Info* info) {
+    const auto result = context->teakra.LoadDsp1({image, size}, precompile);
+    if (!result) {
+        return false;
+    }
+    if (info) {
+        info->memory_layout = result->memory_layout;
+        info->recv_data_on_start = result->recv_data_on_start;
+    }
+    return true;
+}
+
 void Teakra_Run(TeakraContext* context, unsigned cycle) {
     context->teakra.Run(cycle);
 }
 
+uint32_t Teakra_RunUntil(TeakraContext* context, uint32_t max_cycle, uint32_t slice,
+                         Teakra_RunPredicate predicate, void* userdata) {
+    return context->teakra.RunUntil(max_cycle, slice,
+                                    [=]() { return predicate(userdata) != 0; });
+}
+
 void Teakra_SetAHBMCallback(TeakraContext* context, Teakra_AHBMReadCallback8 read8,
                             Teakra_AHBMWriteCallback8 write8, Teakra_AHBMReadCallback16 read16,
                             Teakra_AHBMWriteCallback16 write16, Teakra_AHBMReadCallback32 read32,
@@ -144,4 +179,15 @@ void Teakra_SetAudioCallback(TeakraContext* context, Teakra_AudioCallback callba
     context->teakra.SetAudioCallback(
         [=](std::array<std::int16_t, 2> samples) { callback(userdata, samples.data()); });
 }
+
+void Teakra_SetAudioBlockCallback(TeakraContext* context, size_t frames,
+                                  Teakra_AudioBlockCallback callback, void* userdata) {
+    if (!callback) {
+        context->teakra.SetAudioBlockCallback(frames, nullptr);
+        return;
+    }
+    context->teakra.SetAudioBlockCallback(frames, [=](std::span<const std::int16_t> samples) {
+        callback(userdata, samples.data(), samples.size() / 2);
+    });
+}
 }
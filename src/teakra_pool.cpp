@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <teakra/teakra.h>
+#include <teakra/teakra_pool.h>
+#include "common_types.h"
+#include "crash.h"
+
+namespace Teakra {
+
+struct TeakraPool::Impl {
+    struct Range {
+        std::atomic<std::size_t> next{0};
+        std::size_t end = 0;
+    };
+
+    std::vector<std::unique_ptr<Teakra>> instances;
+    std::size_t thread_count;
+    std::unique_ptr<Range[]> ranges;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::function<void(std::size_t)> task;
+    u64 generation = 0;
+    std::size_t busy = 0;
+    bool quit = false;
+
+    Impl(std::size_t instance_count, std::size_t thread_count_, bool use_jit)
+        : instances(instance_count) {
+        if (thread_count_ == 0) {
+            thread_count_ = std::thread::hardware_concurrency();
+        }
+        thread_count = std::clamp<std::size_t>(thread_count_, 1,
+                                               std::max<std::size_t>(instance_count, 1));
+        ranges = std::make_unique<Range[]>(thread_count);
+        workers.reserve(thread_count);
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this, i] { WorkerLoop(i); });
+        }
+
+        // Construct each instance on the worker that owns it so that its memory is first touched
+        // there.
+        Dispatch([this, use_jit](std::size_t i) {
+            instances[i] = std::make_unique<Teakra>(use_jit);
+        });
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard lock(mutex);
+            quit = true;
+        }
+        work_cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void Dispatch(std::function<void(std::size_t)> function) {
+        const std::size_t count = instances.size();
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            ranges[i].next.store(count * i / thread_count, std::memory_order_relaxed);
+            ranges[i].end = count * (i + 1) / thread_count;
+        }
+
+        std::unique_lock lock(mutex);
+        task = std::move(function);
+        busy = thread_count;
+        ++generation;
+        work_cv.notify_all();
+        done_cv.wait(lock, [this] { return busy == 0; });
+        task = nullptr;
+    }
+
+    void WorkerLoop(std::size_t id) {
+        u64 seen = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                work_cv.wait(lock, [this, seen] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+
+            // Drain our own range first, then steal from the others
+            for (std::size_t k = 0; k < thread_count; ++k) {
+                Range& range = ranges[(id + k) % thread_count];
+                std::size_t i;
+                while ((i = range.next.fetch_add(1, std::memory_order_relaxed)) < range.end) {
+                    task(i);
+                }
+            }
+
+            std::lock_guard lock(mutex);
+            if (--busy == 0)
+                done_cv.notify_one();
+        }
+    }
+};
+
+TeakraPool::TeakraPool(std::size_t instance_count, std::size_t thread_count, bool use_jit)
+    : impl(new Impl(instance_count, thread_count, use_jit)) {}
+
+TeakraPool::~TeakraPool() = default;
+
+std::size_t TeakraPool::GetInstanceCount() const {
+    return impl->instances.size();
+}
+
+std::size_t TeakraPool::GetThreadCount() const {
+    return impl->thread_count;
+}
+
+Teakra& TeakraPool::GetInstance(std::size_t index) {
+    ASSERT(index < impl->instances.size());
+    return *impl->instances[index];
+}
+
+void TeakraPool::Run(std::uint32_t cycle) {
+    impl->Dispatch([this, cycle](std::size_t i) { impl->instances[i]->Run(cycle); });
+}
+
+void TeakraPool::ForEach(const std::function<void(std::size_t index, Teakra& teakra)>& callback) {
+    impl->Dispatch([this, &callback](std::size_t i) { callback(i, *impl->instances[i]); });
+}
+
+} // namespace Teakra
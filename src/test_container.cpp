@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "test_container.h"
+
+namespace Teakra::Test {
+
+namespace {
+// The registers of a State are everything before the test spaces
+constexpr std::size_t RegisterBytes = offsetof(State, test_space_x);
+constexpr std::size_t SpaceBytes = TestSpaceSize * sizeof(u16);
+constexpr std::size_t FixedRecordBytes = 2 * sizeof(u16) + 2 * RegisterBytes + 2 * SpaceBytes;
+
+struct Change {
+    u16 word;
+    u16 value;
+};
+static_assert(sizeof(Change) == 4);
+
+template <typename T>
+T Read(std::span<const u8> data, std::size_t offset) {
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+} // Anonymous namespace
+
+bool IsContainer(std::span<const u8> data) {
+    return data.size() >= sizeof(ContainerHeader) && Read<u32>(data, 0) == ContainerMagic;
+}
+
+ContainerWriter::ContainerWriter() = default;
+
+ContainerWriter::~ContainerWriter() = default;
+
+bool ContainerWriter::Open(const char* path) {
+    file.reset(std::fopen(path, "wb"));
+    if (!file) {
+        return false;
+    }
+    // Filled in by Close
+    const ContainerHeader header{};
+    offset = sizeof(header);
+    record_offsets.clear();
+    opcodes.clear();
+    return std::fwrite(&header, sizeof(header), 1, file.get()) == 1;
+}
+
+bool ContainerWriter::Write(const TestCase& test_case) {
+    std::vector<u8> record(FixedRecordBytes);
+    u8* out = record.data();
+    const auto put = [&out](const void* source, std::size_t size) {
+        std::memcpy(out, source, size);
+        out += size;
+    };
+    put(&test_case.opcode, sizeof(u16));
+    put(&test_case.expand, sizeof(u16));
+    put(&test_case.before, RegisterBytes);
+    put(&test_case.after, RegisterBytes);
+    put(test_case.before.test_space_x.data(), SpaceBytes);
+    put(test_case.before.test_space_y.data(), SpaceBytes);
+
+    std::vector<Change> changes;
+    for (u16 i = 0; i < TestSpaceSize; ++i) {
+        if (test_case.after.test_space_x[i] != test_case.before.test_space_x[i]) {
+            changes.push_back({i, test_case.after.test_space_x[i]});
+        }
+    }
+    for (u16 i = 0; i < TestSpaceSize; ++i) {
+        if (test_case.after.test_space_y[i] != test_case.before.test_space_y[i]) {
+            const u16 word = static_cast<u16>(TestSpaceSize + i);
+            changes.push_back({word, test_case.after.test_space_y[i]});
+        }
+    }
+    const u16 num_changes = static_cast<u16>(changes.size());
+    record.resize(FixedRecordBytes + sizeof(u16) + changes.size() * sizeof(Change));
+    std::memcpy(record.data() + FixedRecordBytes, &num_changes, sizeof(u16));
+    if (!changes.empty()) {
+        std::memcpy(record.data() + FixedRecordBytes + sizeof(u16), changes.data(),
+                    changes.size() * sizeof(Change));
+    }
+
+    if (std::fwrite(record.data(), record.size(), 1, file.get()) != 1) {
+        return false;
+    }
+    record_offsets.push_back(offset);
+    opcodes.push_back(test_case.opcode);
+    offset += record.size();
+    return true;
+}
+
+bool ContainerWriter::Close() {
+    std::vector<u32> cases(opcodes.size());
+    for (u32 i = 0; i < cases.size(); ++i) {
+        cases[i] = i;
+    }
+    std::stable_sort(cases.begin(), cases.end(),
+                     [this](u32 lhs, u32 rhs) { return opcodes[lhs] < opcodes[rhs]; });
+    std::vector<ContainerOpcode> groups;
+    for (u32 i = 0; i < cases.size(); ++i) {
+        const u16 opcode = opcodes[cases[i]];
+        if (groups.empty() || groups.back().opcode != opcode) {
+            groups.push_back({opcode, 0, 0, i});
+        }
+        ++groups.back().count;
+    }
+
+    ContainerHeader header{};
+    header.magic = ContainerMagic;
+    header.version = ContainerVersion;
+    header.num_cases = record_offsets.size();
+    header.index_offset = offset;
+    header.num_opcodes = static_cast<u32>(groups.size());
+
+    std::FILE* f = file.get();
+    const bool ok =
+        std::fwrite(record_offsets.data(), sizeof(u64), record_offsets.size(), f) ==
+            record_offsets.size() &&
+        std::fwrite(groups.data(), sizeof(ContainerOpcode), groups.size(), f) == groups.size() &&
+        std::fwrite(cases.data(), sizeof(u32), cases.size(), f) == cases.size() &&
+        std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, f) == 1;
+    return std::fclose(file.release()) == 0 && ok;
+}
+
+bool ContainerReader::Open(std::span<const u8> data_) {
+    if (!IsContainer(data_)) {
+        return false;
+    }
+    const auto header = Read<ContainerHeader>(data_, 0);
+    if (header.version != ContainerVersion || header.index_offset > data_.size()) {
+        return false;
+    }
+    const u64 index_size = header.num_cases * (sizeof(u64) + sizeof(u32)) +
+                           header.num_opcodes * sizeof(ContainerOpcode);
+    if (header.num_cases > data_.size() || header.num_opcodes > data_.size() ||
+        index_size != data_.size() - header.index_offset) {
+        return false;
+    }
+
+    std::size_t position = header.index_offset;
+    record_offsets.resize(header.num_cases);
+    std::memcpy(record_offsets.data(), data_.data() + position, header.num_cases * sizeof(u64));
+    position += header.num_cases * sizeof(u64);
+    opcodes.resize(header.num_opcodes);
+    std::memcpy(opcodes.data(), data_.data() + position,
+                header.num_opcodes * sizeof(ContainerOpcode));
+    position += header.num_opcodes * sizeof(ContainerOpcode);
+    cases_by_opcode.resize(header.num_cases);
+    std::memcpy(cases_by_opcode.data(), data_.data() + position, header.num_cases * sizeof(u32));
+
+    // Check everything Get relies on up front
+    for (const u64 record : record_offsets) {
+        if (record < sizeof(ContainerHeader) ||
+            record + FixedRecordBytes + sizeof(u16) > header.index_offset) {
+            return false;
+        }
+        const u64 num_changes = Read<u16>(data_, record + FixedRecordBytes);
+        const u64 end = record + FixedRecordBytes + sizeof(u16) + num_changes * sizeof(Change);
+        if (end > header.index_offset) {
+            return false;
+        }
+        for (u64 i = 0; i < num_changes; ++i) {
+            const auto change =
+                Read<Change>(data_, record + FixedRecordBytes + sizeof(u16) + i * sizeof(Change));
+            if (change.word >= 2 * TestSpaceSize) {
+                return false;
+            }
+        }
+    }
+    for (const auto& group : opcodes) {
+        if (group.first + group.count > header.num_cases) {
+            return false;
+        }
+    }
+    for (const u32 index : cases_by_opcode) {
+        if (index >= header.num_cases) {
+            return false;
+        }
+    }
+
+    data = data_;
+    return true;
+}
+
+TestCase ContainerReader::Get(std::size_t index) const {
+    TestCase test_case{};
+    std::size_t position = record_offsets[index];
+    const auto get = [this, &position](void* destination, std::size_t size) {
+        std::memcpy(destination, data.data() + position, size);
+        position += size;
+    };
+    get(&test_case.opcode, sizeof(u16));
+    get(&test_case.expand, sizeof(u16));
+    get(&test_case.before, RegisterBytes);
+    get(&test_case.after, RegisterBytes);
+    get(test_case.before.test_space_x.data(), SpaceBytes);
+    get(test_case.before.test_space_y.data(), SpaceBytes);
+    test_case.after.test_space_x = test_case.before.test_space_x;
+    test_case.after.test_space_y = test_case.before.test_space_y;
+
+    u16 num_changes;
+    get(&num_changes, sizeof(u16));
+    for (u16 i = 0; i < num_changes; ++i) {
+        Change change;
+        get(&change, sizeof(change));
+        if (change.word < TestSpaceSize) {
+            test_case.after.test_space_x[change.word] = change.value;
+        } else {
+            test_case.after.test_space_y[change.word - TestSpaceSize] = change.value;
+        }
+    }
+    return test_case;
+}
+
+std::span<const u32> ContainerReader::CasesWithOpcode(u16 opcode) const {
+    const auto group = std::lower_bound(
+        opcodes.begin(), opcodes.end(), opcode,
+        [](const ContainerOpcode& entry, u16 value) { return entry.opcode < value; });
+    if (group == opcodes.end() || group->opcode != opcode) {
+        return {};
+    }
+    return std::span<const u32>(cases_by_opcode).subspan(group->first, group->count);
+}
+
+} // namespace Teakra::Test
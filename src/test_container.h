@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <vector>
+#include "common_types.h"
+#include "test.h"
+
+namespace Teakra::Test {
+
+// Container for test cases, as an alternative to raw TestCase dumps.
+//
+// Each record stores the registers of both states and the memory of the state before in full,
+// but only the words of the memory after that differ from before. An index at the end of the
+// file gives the offset of every record and the records of every opcode.
+//
+// Layout, in host byte order like the raw dumps:
+//   ContainerHeader
+//   records:  u16 opcode, u16 expand, registers before, registers after,
+//             test_space_x/y before, u16 change count, {u16 word, u16 value} per change,
+//             where word counts test_space_x first, then test_space_y
+//   index:    u64 record offset per case,
+//             ContainerOpcode per distinct opcode, sorted,
+//             u32 case numbers grouped by opcode in the same order
+
+struct ContainerHeader {
+    u32 magic;
+    u32 version;
+    u64 num_cases;
+    u64 index_offset;
+    u32 num_opcodes;
+    u32 reserved;
+};
+
+struct ContainerOpcode {
+    u16 opcode;
+    u16 reserved;
+    u32 count;
+    u64 first; // into the case numbers
+};
+
+constexpr u32 ContainerMagic = 0x4354544B; // "KTTC"
+constexpr u32 ContainerVersion = 1;
+
+bool IsContainer(std::span<const u8> data);
+
+class ContainerWriter {
+public:
+    ContainerWriter();
+    ~ContainerWriter();
+
+    bool Open(const char* path);
+    bool Write(const TestCase& test_case);
+    // Writes the index. Nothing written is usable without it.
+    bool Close();
+
+private:
+    std::unique_ptr<std::FILE, fclose_deleter> file;
+    u64 offset = 0;
+    std::vector<u64> record_offsets;
+    std::vector<u16> opcodes;
+};
+
+// Reads a container from memory, which must outlive the reader. Thread safe once opened.
+class ContainerReader {
+public:
+    // Returns false if the data is not a valid container
+    bool Open(std::span<const u8> data);
+
+    std::size_t NumCases() const {
+        return record_offsets.size();
+    }
+
+    TestCase Get(std::size_t index) const;
+
+    // Case numbers of the records for `opcode`, in file order
+    std::span<const u32> CasesWithOpcode(u16 opcode) const;
+
+private:
+    std::span<const u8> data;
+    std::vector<u64> record_offsets;
+    std::vector<ContainerOpcode> opcodes;
+    std::vector<u32> cases_by_opcode;
+};
+
+} // namespace Teakra::Test
@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "../test.h"
+#include "../test_container.h"
+
+namespace {
+
+std::vector<u8> ReadFile(const char* path) {
+    std::vector<u8> data;
+    std::unique_ptr<std::FILE, fclose_deleter> file{std::fopen(path, "rb")};
+    if (!file) {
+        return data;
+    }
+    u8 chunk[0x10000];
+    std::size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file.get())) != 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    return data;
+}
+
+int Pack(const char* in_path, const char* out_path) {
+    std::unique_ptr<std::FILE, fclose_deleter> in{std::fopen(in_path, "rb")};
+    if (!in) {
+        std::fprintf(stderr, "Unable to open %s\n", in_path);
+        return -2;
+    }
+    Teakra::Test::ContainerWriter writer;
+    if (!writer.Open(out_path)) {
+        std::fprintf(stderr, "Unable to write %s\n", out_path);
+        return -2;
+    }
+    TestCase test_case;
+    std::size_t count = 0;
+    while (std::fread(&test_case, sizeof(test_case), 1, in.get()) == 1) {
+        if (!writer.Write(test_case)) {
+            std::fprintf(stderr, "Unable to write %s\n", out_path);
+            return -2;
+        }
+        ++count;
+    }
+    if (!writer.Close()) {
+        std::fprintf(stderr, "Unable to write %s\n", out_path);
+        return -2;
+    }
+    std::printf("Packed %zu test cases\n", count);
+    return 0;
+}
+
+int Unpack(const char* in_path, const char* out_path) {
+    const std::vector<u8> data = ReadFile(in_path);
+    Teakra::Test::ContainerReader reader;
+    if (!reader.Open(data)) {
+        std::fprintf(stderr, "%s is not a valid test case container\n", in_path);
+        return -2;
+    }
+    std::unique_ptr<std::FILE, fclose_deleter> out{std::fopen(out_path, "wb")};
+    if (!out) {
+        std::fprintf(stderr, "Unable to write %s\n", out_path);
+        return -2;
+    }
+    for (std::size_t i = 0; i < reader.NumCases(); ++i) {
+        const TestCase test_case = reader.Get(i);
+        if (std::fwrite(&test_case, sizeof(test_case), 1, out.get()) != 1) {
+            std::fprintf(stderr, "Unable to write %s\n", out_path);
+            return -2;
+        }
+    }
+    std::printf("Unpacked %zu test cases\n", reader.NumCases());
+    return 0;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc != 4 || (std::strcmp(argv[1], "pack") != 0 && std::strcmp(argv[1], "unpack") != 0)) {
+        std::fprintf(stderr,
+                     "usage: %s pack raw_test_file container\n"
+                     "       %s unpack container raw_test_file\n",
+                     argv[0], argv[0]);
+        return -1;
+    }
+    if (std::strcmp(argv[1], "pack") == 0) {
+        return Pack(argv[2], argv[3]);
+    }
+    return Unpack(argv[2], argv[3]);
+}
@@ -1,8 +1,19 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
+#include <cstdarg>
+#include <cstddef>
 #include <cstdio>
-#include <iomanip>
+#include <cstring>
 #include <memory>
+#include <numeric>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <teakra/disassembler.h>
 #include "../ahbm.h"
 #include "../apbp.h"
@@ -16,8 +27,16 @@
 #include "../mmio.h"
 #include "../shared_memory.h"
 #include "../test.h"
+#include "../test_container.h"
 #include "../timer.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 std::string Flag16ToString(u16 value, const char* symbols) {
     std::string result = symbols;
     for (int i = 0; i < 16; ++i) {
@@ -27,18 +46,129 @@ std::string Flag16ToString(u16 value, const char* symbols) {
     return result;
 }
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::fprintf(stderr, "A filename argument must be provided. Exiting...\n");
-        return -1;
+namespace {
+
+void Append(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    out += line;
+}
+
+// The test file, mapped read-only where the platform allows it and read in whole otherwise.
+// Either a raw dump of TestCase or a container.
+class TestFile {
+public:
+    bool Open(const char* path) {
+        if (!Map(path)) {
+            return false;
+        }
+        const std::span<const u8> bytes{data, size};
+        is_container = Teakra::Test::IsContainer(bytes);
+        return !is_container || container.Open(bytes);
     }
 
-    std::unique_ptr<std::FILE, fclose_deleter> file{std::fopen(argv[1], "rb")};
-    if (!file) {
-        std::fprintf(stderr, "Unable to open file %s. Exiting...\n", argv[1]);
-        return -2;
+    ~TestFile() {
+#ifndef _WIN32
+        if (data) {
+            ::munmap(const_cast<u8*>(data), size);
+        }
+#endif
+    }
+
+    std::size_t NumCases() const {
+        return is_container ? container.NumCases() : size / sizeof(TestCase);
+    }
+
+    TestCase Get(std::size_t index) const {
+        if (is_container) {
+            return container.Get(index);
+        }
+        TestCase test_case;
+        std::memcpy(&test_case, data + index * sizeof(TestCase), sizeof(TestCase));
+        return test_case;
+    }
+
+    // Case numbers whose opcode is in one of the inclusive `ranges`, in file order
+    std::vector<std::size_t> Select(const std::vector<std::pair<u16, u16>>& ranges) const {
+        std::vector<std::size_t> cases;
+        if (is_container) {
+            for (const auto& [first, last] : ranges) {
+                for (u32 opcode = first; opcode <= last; ++opcode) {
+                    const auto found = container.CasesWithOpcode(static_cast<u16>(opcode));
+                    cases.insert(cases.end(), found.begin(), found.end());
+                }
+            }
+            std::sort(cases.begin(), cases.end());
+            cases.erase(std::unique(cases.begin(), cases.end()), cases.end());
+            return cases;
+        }
+        for (std::size_t i = 0; i < NumCases(); ++i) {
+            u16 opcode;
+            std::memcpy(&opcode, data + i * sizeof(TestCase) + offsetof(TestCase, opcode),
+                        sizeof(opcode));
+            if (std::any_of(ranges.begin(), ranges.end(), [opcode](const auto& range) {
+                    return opcode >= range.first && opcode <= range.second;
+                })) {
+                cases.push_back(i);
+            }
+        }
+        return cases;
     }
 
+private:
+    bool Map(const char* path) {
+#ifndef _WIN32
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        if (size != 0) {
+            void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            data = static_cast<const u8*>(mapped);
+            ::madvise(mapped, size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        return true;
+#else
+        std::unique_ptr<std::FILE, fclose_deleter> file{std::fopen(path, "rb")};
+        if (!file) {
+            return false;
+        }
+        u8 chunk[0x10000];
+        std::size_t read;
+        while ((read = std::fread(chunk, 1, sizeof(chunk), file.get())) != 0) {
+            buffer.insert(buffer.end(), chunk, chunk + read);
+        }
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+#endif
+    }
+
+    const u8* data = nullptr;
+    std::size_t size = 0;
+    bool is_container = false;
+    Teakra::Test::ContainerReader container;
+#ifdef _WIN32
+    std::vector<u8> buffer;
+#endif
+};
+
+// A complete DSP, peripherals included, with both cores. Each worker thread has its own.
+struct Core {
     std::array<Teakra::Timer, 2> timer{};
     std::array<Teakra::Btdmp, 2> btdmp{};
     Teakra::CoreTiming core_timing{timer, btdmp};
@@ -51,318 +181,492 @@ int main(int argc, char** argv) {
     Teakra::MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
     Teakra::MemoryInterface memory_interface{shared_memory, miu, mmio};
     Teakra::RegisterState regs;
-    Teakra::Interpreter interpreter(core_timing, regs, memory_interface);
-
+    Teakra::Interpreter interpreter{core_timing, regs, memory_interface};
     Teakra::JitRegisters jregs;
-    Teakra::EmitX64 jit(core_timing, jregs, memory_interface);
+    Teakra::EmitX64 jit{core_timing, jregs, memory_interface};
+};
+
+// The registers the test cases record, read back from either core
+struct Result {
+    std::array<u64, 2> a, b;
+    std::array<u32, 2> p;
+    std::array<u16, 8> r;
+    std::array<u16, 2> x, y;
+    u16 stepi0, stepj0, mixp, sv, repc, lc, cfgi, cfgj;
+};
 
+void SetInterpreterState(Teakra::RegisterState& regs, const State& before) {
     regs.Reset();
-    printf("ar0 = 0x%x\n", regs.Get<Teakra::ar0>());
-    printf("ar1 = 0x%x\n", regs.Get<Teakra::ar1>());
-    printf("arp0 = 0x%x\n", regs.Get<Teakra::arp0>());
-    printf("arp1 = 0x%x\n", regs.Get<Teakra::arp1>());
-    printf("arp2 = 0x%x\n", regs.Get<Teakra::arp2>());
-    printf("arp3 = 0x%x\n", regs.Get<Teakra::arp3>());
-
-    int i = 0;
-    int passed = 0;
-    int total = 0;
-    int skipped = 0;
-    while (true) {
-        TestCase test_case;
-        if (std::fread(&test_case, sizeof(test_case), 1, file.get()) == 0) {
-            break;
-        }
-        regs.Reset();
-        regs.a = test_case.before.a;
-        regs.b = test_case.before.b;
-        regs.p = test_case.before.p;
-        regs.r = test_case.before.r;
-        regs.x = test_case.before.x;
-        regs.y = test_case.before.y;
-        regs.stepi0 = test_case.before.stepi0;
-        regs.stepj0 = test_case.before.stepj0;
-        regs.mixp = test_case.before.mixp;
-        regs.sv = test_case.before.sv;
-        regs.repc = test_case.before.repc;
-        regs.Lc() = test_case.before.lc;
-        regs.Set<Teakra::cfgi>(test_case.before.cfgi);
-        regs.Set<Teakra::cfgj>(test_case.before.cfgj);
-        regs.Set<Teakra::stt0>(test_case.before.stt0);
-        regs.Set<Teakra::stt1>(test_case.before.stt1);
-        regs.Set<Teakra::stt2>(test_case.before.stt2);
-        regs.Set<Teakra::mod0>(test_case.before.mod0);
-        regs.Set<Teakra::mod1>(test_case.before.mod1);
-        regs.Set<Teakra::mod2>(test_case.before.mod2);
-        regs.Set<Teakra::ar0>(test_case.before.ar[0]);
-        regs.Set<Teakra::ar1>(test_case.before.ar[1]);
-        regs.Set<Teakra::arp0>(test_case.before.arp[0]);
-        regs.Set<Teakra::arp1>(test_case.before.arp[1]);
-        regs.Set<Teakra::arp2>(test_case.before.arp[2]);
-        regs.Set<Teakra::arp3>(test_case.before.arp[3]);
-
-        jregs.Reset();
-        jregs.a = test_case.before.a;
-        jregs.b = test_case.before.b;
-        jregs.p = test_case.before.p;
-        jregs.r = test_case.before.r;
-        jregs.x = test_case.before.x;
-        jregs.y = test_case.before.y;
-        jregs.stepi0 = test_case.before.stepi0;
-        jregs.stepj0 = test_case.before.stepj0;
-        jregs.mixp = test_case.before.mixp;
-        jregs.sv = test_case.before.sv;
-        jregs.repc = test_case.before.repc;
-        jregs.bkrep_stack[0].lc = test_case.before.lc;
-        jregs.cfgi.raw = test_case.before.cfgi;
-        jregs.cfgj.raw = test_case.before.cfgj;
-        jregs.flags.raw = test_case.before.stt0 << 1;
-        // stt1
-        auto stt1 = std::bit_cast<Teakra::Stt1>(test_case.before.stt1);
-        jregs.flags.fr.Assign(stt1.fr);
-        jregs.pe[0] = stt1.pe0;
-        jregs.pe[1] = stt1.pe1;
-        // stt2
-        auto stt2 = std::bit_cast<Teakra::Stt2>(test_case.before.stt2);
-        jregs.pcmhi = stt2.pcmhi;
-        if (stt2.lp != 0) {
-            jregs.lp = 0;
-            jregs.bcn = 0;
-        }
-        jregs.mod0.raw = test_case.before.mod0;
-        jregs.mod0.mod0_unk_const.Assign(1);
-        jregs.mod1.raw = test_case.before.mod1;
-        jregs.mod2.raw = test_case.before.mod2;
-        jregs.ar[0].raw = test_case.before.ar[0];
-        jregs.ar[1].raw = test_case.before.ar[1];
-        jregs.arp[0].raw = test_case.before.arp[0];
-        jregs.arp[1].raw = test_case.before.arp[1];
-        jregs.arp[2].raw = test_case.before.arp[2];
-        jregs.arp[3].raw = test_case.before.arp[3];
+    regs.a = before.a;
+    regs.b = before.b;
+    regs.p = before.p;
+    regs.r = before.r;
+    regs.x = before.x;
+    regs.y = before.y;
+    regs.stepi0 = before.stepi0;
+    regs.stepj0 = before.stepj0;
+    regs.mixp = before.mixp;
+    regs.sv = before.sv;
+    regs.repc = before.repc;
+    regs.Lc() = before.lc;
+    regs.Set<Teakra::cfgi>(before.cfgi);
+    regs.Set<Teakra::cfgj>(before.cfgj);
+    regs.Set<Teakra::stt0>(before.stt0);
+    regs.Set<Teakra::stt1>(before.stt1);
+    regs.Set<Teakra::stt2>(before.stt2);
+    regs.Set<Teakra::mod0>(before.mod0);
+    regs.Set<Teakra::mod1>(before.mod1);
+    regs.Set<Teakra::mod2>(before.mod2);
+    regs.Set<Teakra::ar0>(before.ar[0]);
+    regs.Set<Teakra::ar1>(before.ar[1]);
+    regs.Set<Teakra::arp0>(before.arp[0]);
+    regs.Set<Teakra::arp1>(before.arp[1]);
+    regs.Set<Teakra::arp2>(before.arp[2]);
+    regs.Set<Teakra::arp3>(before.arp[3]);
+}
 
-        for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
-            memory_interface.DataWrite(TestSpaceX + offset, test_case.before.test_space_x[offset]);
-            memory_interface.DataWrite(TestSpaceY + offset, test_case.before.test_space_y[offset]);
+void SetJitState(Teakra::JitRegisters& jregs, const State& before) {
+    jregs.Reset();
+    jregs.a = before.a;
+    jregs.b = before.b;
+    jregs.p = before.p;
+    jregs.r = before.r;
+    jregs.x = before.x;
+    jregs.y = before.y;
+    jregs.stepi0 = before.stepi0;
+    jregs.stepj0 = before.stepj0;
+    jregs.mixp = before.mixp;
+    jregs.sv = before.sv;
+    jregs.repc = before.repc;
+    jregs.bkrep_stack[0].lc = before.lc;
+    jregs.cfgi.raw = before.cfgi;
+    jregs.cfgj.raw = before.cfgj;
+    jregs.flags.raw = before.stt0 << 1;
+    // stt1
+    auto stt1 = std::bit_cast<Teakra::Stt1>(before.stt1);
+    jregs.flags.fr.Assign(stt1.fr);
+    jregs.pe[0] = stt1.pe0;
+    jregs.pe[1] = stt1.pe1;
+    // stt2
+    auto stt2 = std::bit_cast<Teakra::Stt2>(before.stt2);
+    jregs.pcmhi = stt2.pcmhi;
+    if (stt2.lp != 0) {
+        jregs.lp = 0;
+        jregs.bcn = 0;
+    }
+    jregs.mod0.raw = before.mod0;
+    jregs.mod0.mod0_unk_const.Assign(1);
+    jregs.mod1.raw = before.mod1;
+    jregs.mod2.raw = before.mod2;
+    jregs.ar[0].raw = before.ar[0];
+    jregs.ar[1].raw = before.ar[1];
+    jregs.arp[0].raw = before.arp[0];
+    jregs.arp[1].raw = before.arp[1];
+    jregs.arp[2].raw = before.arp[2];
+    jregs.arp[3].raw = before.arp[3];
+}
+
+Result GetResult(Teakra::RegisterState& regs) {
+    Result result;
+    result.a = regs.a;
+    result.b = regs.b;
+    result.p = regs.p;
+    result.r = regs.r;
+    result.x = regs.x;
+    result.y = regs.y;
+    result.stepi0 = regs.stepi0;
+    result.stepj0 = regs.stepj0;
+    result.mixp = regs.mixp;
+    result.sv = regs.sv;
+    result.repc = regs.repc;
+    result.lc = regs.Lc();
+    result.cfgi = regs.Get<Teakra::cfgi>();
+    result.cfgj = regs.Get<Teakra::cfgj>();
+    return result;
+}
+
+Result GetResult(const Teakra::JitRegisters& jregs) {
+    Result result;
+    result.a = jregs.a;
+    result.b = jregs.b;
+    result.p = jregs.p;
+    result.r = jregs.r;
+    result.x = jregs.x;
+    result.y = jregs.y;
+    result.stepi0 = jregs.stepi0;
+    result.stepj0 = jregs.stepj0;
+    result.mixp = jregs.mixp;
+    result.sv = jregs.sv;
+    result.repc = jregs.repc;
+    result.lc = jregs.bkrep_stack[0].lc;
+    result.cfgi = jregs.cfgi.raw;
+    result.cfgj = jregs.cfgj.raw;
+    return result;
+}
+
+void PrintBefore(std::string& out, const State& before) {
+    Append(out, "before:\n");
+    Append(out, "a0 = %010" PRIx64 "; a1 = %010" PRIx64 "\n", before.a[0] & 0xFF'FFFF'FFFF,
+           before.a[1] & 0xFF'FFFF'FFFF);
+    Append(out, "b0 = %010" PRIx64 "; b1 = %010" PRIx64 "\n", before.b[0] & 0xFF'FFFF'FFFF,
+           before.b[1] & 0xFF'FFFF'FFFF);
+    Append(out, "p0 = %08X; p1 = %08X\n", before.p[0], before.p[1]);
+    Append(out, "x0 = %04X; x1 = %04X\n", before.x[0], before.x[1]);
+    Append(out, "y0 = %04X; y1 = %04X\n", before.y[0], before.y[1]);
+    Append(out, "r0 = %04X; r1 = %04X; r2 = %04X; r3 = %04X\n", before.r[0], before.r[1],
+           before.r[2], before.r[3]);
+    Append(out, "r4 = %04X; r5 = %04X; r6 = %04X; r7 = %04X\n", before.r[4], before.r[5],
+           before.r[6], before.r[7]);
+    Append(out, "stepi0 = %04X\n", before.stepi0);
+    Append(out, "stepj0 = %04X\n", before.stepj0);
+    Append(out, "mixp = %04X\n", before.mixp);
+    Append(out, "sv = %04X\n", before.sv);
+    Append(out, "repc = %04X\n", before.repc);
+    Append(out, "lc = %04X\n", before.lc);
+    Append(out, "cfgi = %s\n", Flag16ToString(before.cfgi, "mmmmmmmmmsssssss").c_str());
+    Append(out, "cfgj = %s\n", Flag16ToString(before.cfgj, "mmmmmmmmmsssssss").c_str());
+    Append(out, "stt0 = %s\n", Flag16ToString(before.stt0, "####C###ZMNVCELL").c_str());
+    Append(out, "stt1 = %s\n", Flag16ToString(before.stt1, "QP#########R####").c_str());
+    Append(out, "stt2 = %s\n", Flag16ToString(before.stt2, "LBBB####mm##V21I").c_str());
+    Append(out, "mod0 = %s\n", Flag16ToString(before.mod0, "#QQ#PPooSYY###SS").c_str());
+    Append(out, "mod1 = %s\n", Flag16ToString(before.mod1, "jicB####pppppppp").c_str());
+    Append(out, "mod2 = %s\n", Flag16ToString(before.mod2, "7654321m7654321M").c_str());
+    Append(out, "ar0 = %s\n", Flag16ToString(before.ar[0], "RRRRRRoosssoosss").c_str());
+    Append(out, "ar1 = %s\n", Flag16ToString(before.ar[1], "RRRRRRoosssoosss").c_str());
+    Append(out, "arp0 = %s\n", Flag16ToString(before.arp[0], "#RR#RRiiiiijjjjj").c_str());
+    Append(out, "arp1 = %s\n", Flag16ToString(before.arp[1], "#RR#RRiiiiijjjjj").c_str());
+    Append(out, "arp2 = %s\n", Flag16ToString(before.arp[2], "#RR#RRiiiiijjjjj").c_str());
+    Append(out, "arp3 = %s\n", Flag16ToString(before.arp[3], "#RR#RRiiiiijjjjj").c_str());
+    Append(out, "FAILED\n~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n\n");
+}
+
+enum class Outcome { Pass, Fail, Skip };
+
+// Runs one case and appends the report of a failure or skip to `out`
+Outcome Verify(Core& core, const TestCase& test_case, std::size_t index, bool use_jit,
+               std::string& out) {
+    auto& memory_interface = core.memory_interface;
+    if (use_jit) {
+        SetJitState(core.jregs, test_case.before);
+    } else {
+        SetInterpreterState(core.regs, test_case.before);
+    }
+
+    for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
+        memory_interface.DataWrite(TestSpaceX + offset, test_case.before.test_space_x[offset]);
+        memory_interface.DataWrite(TestSpaceY + offset, test_case.before.test_space_y[offset]);
+    }
+
+    memory_interface.ProgramWrite(0, test_case.opcode);
+    memory_interface.ProgramWrite(1, test_case.expand);
+
+    bool pass = true;
+    bool skip = false;
+    try {
+        Result result;
+        if (use_jit) {
+            // Every case puts a different instruction at the same address
+            core.jit.ClearBlockCache();
+            core.jit.unimplemented = false;
+            core.jit.Run(1);
+            if (core.jit.unimplemented) {
+                throw Teakra::UnimplementedException();
+            }
+            result = GetResult(core.jregs);
+        } else {
+            core.interpreter.Run(1);
+            result = GetResult(core.regs);
         }
 
-        memory_interface.ProgramWrite(0, test_case.opcode);
-        memory_interface.ProgramWrite(1, test_case.expand);
-
-        bool pass = true;
-        bool skip = false;
-        try {
-            /*if (i >= 40064 && i <= 45999) {
-                i++;
-                continue;
-            }*/
-            if (i == 39047) {
-                printf("bad\n");
+        auto Check40 = [&](const char* name, u64 expected, u64 actual) {
+            if (expected != actual) {
+                Append(out, "Mismatch: %s: %010" PRIx64 " != %010" PRIx64 "\n", name,
+                       expected & 0xFF'FFFF'FFFF, actual & 0xFF'FFFF'FFFF);
+                pass = false;
             }
-            // interpreter.Run(1);
-            jit.unimplemented = false;
-            jit.Run(1);
-            if (jit.unimplemented) {
-                throw Teakra::UnimplementedException();
+        };
+
+        auto Check32 = [&](const char* name, u32 expected, u32 actual) {
+            if (expected != actual) {
+                Append(out, "Mismatch: %s: %08X != %08X\n", name, expected, actual);
+                pass = false;
             }
-            auto Check40 = [&](const char* name, u64 expected, u64 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %010" PRIx64 " != %010" PRIx64 "\n", name,
-                                expected & 0xFF'FFFF'FFFF, actual & 0xFF'FFFF'FFFF);
-                    pass = false;
-                }
-            };
+        };
 
-            auto Check32 = [&](const char* name, u32 expected, u32 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %08X != %08X\n", name, expected, actual);
-                    pass = false;
-                }
-            };
+        auto Check = [&](const char* name, u16 expected, u16 actual) {
+            if (expected != actual) {
+                Append(out, "Mismatch: %s: %04X != %04X\n", name, expected, actual);
+                pass = false;
+            }
+        };
 
-            auto Check = [&](const char* name, u16 expected, u16 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %04X != %04X\n", name, expected, actual);
-                    pass = false;
-                }
-            };
+        auto CheckAddress = [&](const char* name, u16 address, u16 expected, u16 actual) {
+            if (expected != actual) {
+                Append(out, "Mismatch: %s%04X: %04X != %04X\n", name, address, expected, actual);
+                pass = false;
+            }
+        };
 
-            auto CheckAddress = [&](const char* name, u16 address, u16 expected, u16 actual) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s%04X: %04X != %04X\n", name, address, expected,
-                                actual);
-                    pass = false;
-                }
-            };
-
-            auto CheckFlag = [&](const char* name, u16 expected, u16 actual, const char* symbols) {
-                if (expected != actual) {
-                    std::printf("Mismatch: %s: %s != %s\n", name,
-                                Flag16ToString(expected, symbols).c_str(),
-                                Flag16ToString(actual, symbols).c_str());
-                    pass = false;
-                }
-            };
-
-            Check40("a0", SignExtend<40>(test_case.after.a[0]), jregs.a[0]);
-            Check40("a1", SignExtend<40>(test_case.after.a[1]), jregs.a[1]);
-            Check40("b0", SignExtend<40>(test_case.after.b[0]), jregs.b[0]);
-            Check40("b1", SignExtend<40>(test_case.after.b[1]), jregs.b[1]);
-            Check32("p0", test_case.after.p[0], jregs.p[0]);
-            Check32("p1", test_case.after.p[1], jregs.p[1]);
-            Check("r0", test_case.after.r[0], jregs.r[0]);
-            Check("r1", test_case.after.r[1], jregs.r[1]);
-            Check("r2", test_case.after.r[2], jregs.r[2]);
-            Check("r3", test_case.after.r[3], jregs.r[3]);
-            Check("r4", test_case.after.r[4], jregs.r[4]);
-            Check("r5", test_case.after.r[5], jregs.r[5]);
-            Check("r6", test_case.after.r[6], jregs.r[6]);
-            Check("r7", test_case.after.r[7], jregs.r[7]);
-            Check("x0", test_case.after.x[0], jregs.x[0]);
-            Check("x1", test_case.after.x[1], jregs.x[1]);
-            Check("y0", test_case.after.y[0], jregs.y[0]);
-            Check("y1", test_case.after.y[1], jregs.y[1]);
-            Check("stepi0", test_case.after.stepi0, jregs.stepi0);
-            Check("stepj0", test_case.after.stepj0, jregs.stepj0);
-            Check("mixp", test_case.after.mixp, jregs.mixp);
-            Check("sv", test_case.after.sv, jregs.sv);
-            Check("repc", test_case.after.repc, jregs.repc);
-            Check("lc", test_case.after.lc, jregs.bkrep_stack[0].lc);
-            CheckFlag("cfgi", test_case.after.cfgi, jregs.cfgi.raw, "mmmmmmmmmsssssss");
-            CheckFlag("cfgj", test_case.after.cfgj, jregs.cfgj.raw, "mmmmmmmmmsssssss");
-            // CheckFlag("mod0", test_case.after.mod0, jregs.mod0.raw, "#QQ#PPooSYY###SS");
-            // CheckFlag("mod1", test_case.after.mod1, jregs.mod1.raw, "???B####pppppppp");
-            // CheckFlag("mod2", test_case.after.mod2, jregs.mod2.raw, "7654321m7654321M");
-            // CheckFlag("ar0", test_case.after.ar[0], jregs.ar[0].raw, "RRRRRRoosssoosss");
-            // CheckFlag("ar1", test_case.after.ar[1], jregs.ar[1].raw, "RRRRRRoosssoosss");
-            // CheckFlag("arp0", test_case.after.arp[0], jregs.arp[0].raw, "#RR#RRjjjjjiiiii");
-            // CheckFlag("arp1", test_case.after.arp[1], jregs.arp[1].raw, "#RR#RRjjjjjiiiii");
-            // CheckFlag("arp2", test_case.after.arp[2], jregs.arp[2].raw, "#RR#RRjjjjjiiiii");
-            // CheckFlag("arp3", test_case.after.arp[3], jregs.arp[3].raw, "#RR#RRjjjjjiiiii");
-
-            // Check40("a0", SignExtend<40>(test_case.after.a[0]), regs.a[0]);
-            // Check40("a1", SignExtend<40>(test_case.after.a[1]), regs.a[1]);
-            // Check40("b0", SignExtend<40>(test_case.after.b[0]), regs.b[0]);
-            // Check40("b1", SignExtend<40>(test_case.after.b[1]), regs.b[1]);
-            // Check32("p0", test_case.after.p[0], regs.p[0]);
-            // Check32("p1", test_case.after.p[1], regs.p[1]);
-            // Check("r0", test_case.after.r[0], regs.r[0]);
-            // Check("r1", test_case.after.r[1], regs.r[1]);
-            // Check("r2", test_case.after.r[2], regs.r[2]);
-            // Check("r3", test_case.after.r[3], regs.r[3]);
-            // Check("r4", test_case.after.r[4], regs.r[4]);
-            // Check("r5", test_case.after.r[5], regs.r[5]);
-            // Check("r6", test_case.after.r[6], regs.r[6]);
-            // Check("r7", test_case.after.r[7], regs.r[7]);
-            // Check("x0", test_case.after.x[0], regs.x[0]);
-            // Check("x1", test_case.after.x[1], regs.x[1]);
-            // Check("y0", test_case.after.y[0], regs.y[0]);
-            // Check("y1", test_case.after.y[1], regs.y[1]);
-            // Check("stepi0", test_case.after.stepi0, regs.stepi0);
-            // Check("stepj0", test_case.after.stepj0, regs.stepj0);
-            // Check("mixp", test_case.after.mixp, regs.mixp);
-            // Check("sv", test_case.after.sv, regs.sv);
-            // Check("repc", test_case.after.repc, regs.repc);
-            // Check("lc", test_case.after.lc, regs.Lc());
-            // CheckFlag("cfgi", test_case.after.cfgi, regs.Get<Teakra::cfgi>(),
-            // "mmmmmmmmmsssssss"); CheckFlag("cfgj", test_case.after.cfgj,
-            // regs.Get<Teakra::cfgj>(), "mmmmmmmmmsssssss"); CheckFlag("stt0",
-            // test_case.after.stt0, regs.Get<Teakra::stt0>(), "####C###ZMNVCELL");
-            // CheckFlag("stt1", test_case.after.stt1, regs.Get<Teakra::stt1>(),
-            // "QP#########R####"); CheckFlag("stt2", test_case.after.stt2,
-            // regs.Get<Teakra::stt2>(), "LBBB####mm##V21I"); CheckFlag("mod0",
-            // test_case.after.mod0, regs.Get<Teakra::mod0>(), "#QQ#PPooSYY###SS");
-            // CheckFlag("mod1", test_case.after.mod1, regs.Get<Teakra::mod1>(),
-            // "???B####pppppppp"); CheckFlag("mod2", test_case.after.mod2,
-            // regs.Get<Teakra::mod2>(), "7654321m7654321M"); CheckFlag("ar0",
-            // test_case.after.ar[0], regs.Get<Teakra::ar0>(), "RRRRRRoosssoosss"); CheckFlag("ar1",
-            // test_case.after.ar[1], regs.Get<Teakra::ar1>(), "RRRRRRoosssoosss");
-            // CheckFlag("arp0", test_case.after.arp[0], regs.Get<Teakra::arp0>(),
-            // "#RR#RRjjjjjiiiii"); CheckFlag("arp1", test_case.after.arp[1],
-            // regs.Get<Teakra::arp1>(), "#RR#RRjjjjjiiiii"); CheckFlag("arp2",
-            // test_case.after.arp[2], regs.Get<Teakra::arp2>(), "#RR#RRjjjjjiiiii");
-            // CheckFlag("arp3", test_case.after.arp[3], regs.Get<Teakra::arp3>(),
-            // "#RR#RRjjjjjiiiii");
-
-            for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
-                CheckAddress("memory_", (TestSpaceX + offset), test_case.after.test_space_x[offset],
-                             memory_interface.DataRead(TestSpaceX + offset));
-                CheckAddress("memory_", (TestSpaceY + offset), test_case.after.test_space_y[offset],
-                             memory_interface.DataRead(TestSpaceY + offset));
+        auto CheckFlag = [&](const char* name, u16 expected, u16 actual, const char* symbols) {
+            if (expected != actual) {
+                Append(out, "Mismatch: %s: %s != %s\n", name,
+                       Flag16ToString(expected, symbols).c_str(),
+                       Flag16ToString(actual, symbols).c_str());
+                pass = false;
             }
-            ++total;
-        } catch (const Teakra::UnimplementedException&) {
-            std::printf("Skipped one unimplemented case\n");
-            pass = false;
-            skip = true;
-            ++skipped;
+        };
+
+        const State& after = test_case.after;
+        Check40("a0", SignExtend<40>(after.a[0]), result.a[0]);
+        Check40("a1", SignExtend<40>(after.a[1]), result.a[1]);
+        Check40("b0", SignExtend<40>(after.b[0]), result.b[0]);
+        Check40("b1", SignExtend<40>(after.b[1]), result.b[1]);
+        Check32("p0", after.p[0], result.p[0]);
+        Check32("p1", after.p[1], result.p[1]);
+        Check("r0", after.r[0], result.r[0]);
+        Check("r1", after.r[1], result.r[1]);
+        Check("r2", after.r[2], result.r[2]);
+        Check("r3", after.r[3], result.r[3]);
+        Check("r4", after.r[4], result.r[4]);
+        Check("r5", after.r[5], result.r[5]);
+        Check("r6", after.r[6], result.r[6]);
+        Check("r7", after.r[7], result.r[7]);
+        Check("x0", after.x[0], result.x[0]);
+        Check("x1", after.x[1], result.x[1]);
+        Check("y0", after.y[0], result.y[0]);
+        Check("y1", after.y[1], result.y[1]);
+        Check("stepi0", after.stepi0, result.stepi0);
+        Check("stepj0", after.stepj0, result.stepj0);
+        Check("mixp", after.mixp, result.mixp);
+        Check("sv", after.sv, result.sv);
+        Check("repc", after.repc, result.repc);
+        Check("lc", after.lc, result.lc);
+        CheckFlag("cfgi", after.cfgi, result.cfgi, "mmmmmmmmmsssssss");
+        CheckFlag("cfgj", after.cfgj, result.cfgj, "mmmmmmmmmsssssss");
+
+        for (u16 offset = 0; offset < TestSpaceSize; ++offset) {
+            CheckAddress("memory_", (TestSpaceX + offset), after.test_space_x[offset],
+                         memory_interface.DataRead(TestSpaceX + offset));
+            CheckAddress("memory_", (TestSpaceY + offset), after.test_space_y[offset],
+                         memory_interface.DataRead(TestSpaceY + offset));
+        }
+    } catch (const Teakra::UnimplementedException&) {
+        Append(out, "Skipped one unimplemented case\n");
+        pass = false;
+        skip = true;
+    }
+
+    if (pass) {
+        return Outcome::Pass;
+    }
+
+    Teakra::Disassembler::ArArpSettings ar_arp;
+    ar_arp.ar = test_case.before.ar;
+    ar_arp.arp = test_case.before.arp;
+    Append(out, "Test case %zu: %04X %04X %s\n", index, test_case.opcode, test_case.expand,
+           Teakra::Disassembler::Do(test_case.opcode, test_case.expand, ar_arp).c_str());
+    if (skip) {
+        return Outcome::Skip;
+    }
+    PrintBefore(out, test_case.before);
+    return Outcome::Fail;
+}
+
+// Cases are handed out to the workers in chunks of this many; the reports are printed in chunk
+// order so that the output does not depend on the thread count
+constexpr std::size_t ChunkSize = 256;
+
+struct Chunk {
+    std::string output;
+    std::vector<std::size_t> failed;
+    std::vector<std::size_t> skipped;
+    std::size_t passed = 0;
+};
+
+std::string JsonString(const char* text) {
+    std::string result = "\"";
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            result += '\\';
+            result += *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            Append(result, "\\u%04x", *c);
+        } else {
+            result += *c;
+        }
+    }
+    return result + "\"";
+}
+
+void WriteIndices(std::FILE* file, const char* name, const std::vector<std::size_t>& indices) {
+    std::fprintf(file, "  \"%s\": [", name);
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        std::fprintf(file, "%s%zu", i == 0 ? "" : ", ", indices[i]);
+    }
+    std::fprintf(file, "]");
+}
+
+// Parses a comma separated list of hexadecimal opcodes and first-last ranges
+bool ParseOpcodes(const char* text, std::vector<std::pair<u16, u16>>& ranges) {
+    const auto parse = [](const char*& c, u16& value) {
+        char* end;
+        const unsigned long parsed = std::strtoul(c, &end, 16);
+        if (end == c || parsed > 0xFFFF) {
+            return false;
+        }
+        value = static_cast<u16>(parsed);
+        c = end;
+        return true;
+    };
+    for (const char* c = text;; ++c) {
+        u16 first, last;
+        if (!parse(c, first)) {
+            return false;
+        }
+        last = first;
+        if (*c == '-' && (!parse(++c, last) || last < first)) {
+            return false;
+        }
+        ranges.emplace_back(first, last);
+        if (*c == '\0') {
+            return true;
         }
+        if (*c != ',') {
+            return false;
+        }
+    }
+}
 
-        if (pass) {
-            ++passed;
+void Usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [-j threads] [--interpreter] [--opcodes list] [--json summary.json] "
+                 "test_file\n"
+                 "  -j             worker threads, default: one per hardware thread\n"
+                 "  --interpreter  verify the interpreter instead of the JIT\n"
+                 "  --opcodes      only verify cases of these opcodes, e.g. 4180,8800-88FF (hex)\n"
+                 "  --json         also write a summary with the failed and skipped cases\n"
+                 "test_file is a raw dump of test cases or a container made by test_packer\n",
+                 program);
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    const char* json_path = nullptr;
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool use_jit = true;
+    std::vector<std::pair<u16, u16>> opcode_ranges;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--opcodes" && i + 1 < argc) {
+            if (!ParseOpcodes(argv[++i], opcode_ranges)) {
+                Usage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--interpreter") {
+            use_jit = false;
+        } else if (!path && arg[0] != '-') {
+            path = argv[i];
         } else {
-            Teakra::Disassembler::ArArpSettings ar_arp;
-            ar_arp.ar = test_case.before.ar;
-            ar_arp.arp = test_case.before.arp;
-            std::printf(
-                "Test case %d: %04X %04X %s\n", i, test_case.opcode, test_case.expand,
-                Teakra::Disassembler::Do(test_case.opcode, test_case.expand, ar_arp).c_str());
-            if (!skip) {
-                std::printf("before:\n");
-                std::printf("a0 = %010" PRIx64 "; a1 = %010" PRIx64 "\n",
-                            test_case.before.a[0] & 0xFF'FFFF'FFFF,
-                            test_case.before.a[1] & 0xFF'FFFF'FFFF);
-                std::printf("b0 = %010" PRIx64 "; b1 = %010" PRIx64 "\n",
-                            test_case.before.b[0] & 0xFF'FFFF'FFFF,
-                            test_case.before.b[1] & 0xFF'FFFF'FFFF);
-                std::printf("p0 = %08X; p1 = %08X\n", test_case.before.p[0], test_case.before.p[1]);
-                std::printf("x0 = %04X; x1 = %04X\n", test_case.before.x[0], test_case.before.x[1]);
-                std::printf("y0 = %04X; y1 = %04X\n", test_case.before.y[0], test_case.before.y[1]);
-                std::printf("r0 = %04X; r1 = %04X; r2 = %04X; r3 = %04X\n", test_case.before.r[0],
-                            test_case.before.r[1], test_case.before.r[2], test_case.before.r[3]);
-                std::printf("r4 = %04X; r5 = %04X; r6 = %04X; r7 = %04X\n", test_case.before.r[4],
-                            test_case.before.r[5], test_case.before.r[6], test_case.before.r[7]);
-                std::printf("stepi0 = %04X\n", test_case.before.stepi0);
-                std::printf("stepj0 = %04X\n", test_case.before.stepj0);
-                std::printf("mixp = %04X\n", test_case.before.mixp);
-                std::printf("sv = %04X\n", test_case.before.sv);
-                std::printf("repc = %04X\n", test_case.before.repc);
-                std::printf("lc = %04X\n", test_case.before.lc);
-                std::printf("cfgi = %s\n",
-                            Flag16ToString(test_case.before.cfgi, "mmmmmmmmmsssssss").c_str());
-                std::printf("cfgj = %s\n",
-                            Flag16ToString(test_case.before.cfgj, "mmmmmmmmmsssssss").c_str());
-                std::printf("stt0 = %s\n",
-                            Flag16ToString(test_case.before.stt0, "####C###ZMNVCELL").c_str());
-                std::printf("stt1 = %s\n",
-                            Flag16ToString(test_case.before.stt1, "QP#########R####").c_str());
-                std::printf("stt2 = %s\n",
-                            Flag16ToString(test_case.before.stt2, "LBBB####mm##V21I").c_str());
-                std::printf("mod0 = %s\n",
-                            Flag16ToString(test_case.before.mod0, "#QQ#PPooSYY###SS").c_str());
-                std::printf("mod1 = %s\n",
-                            Flag16ToString(test_case.before.mod1, "jicB####pppppppp").c_str());
-                std::printf("mod2 = %s\n",
-                            Flag16ToString(test_case.before.mod2, "7654321m7654321M").c_str());
-                std::printf("ar0 = %s\n",
-                            Flag16ToString(test_case.before.ar[0], "RRRRRRoosssoosss").c_str());
-                std::printf("ar1 = %s\n",
-                            Flag16ToString(test_case.before.ar[1], "RRRRRRoosssoosss").c_str());
-                std::printf("arp0 = %s\n",
-                            Flag16ToString(test_case.before.arp[0], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("arp1 = %s\n",
-                            Flag16ToString(test_case.before.arp[1], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("arp2 = %s\n",
-                            Flag16ToString(test_case.before.arp[2], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("arp3 = %s\n",
-                            Flag16ToString(test_case.before.arp[3], "#RR#RRiiiiijjjjj").c_str());
-                std::printf("FAILED\n~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n\n");
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+    if (!path) {
+        std::fprintf(stderr, "A filename argument must be provided. Exiting...\n");
+        return -1;
+    }
+    if (threads == 0) {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    TestFile file;
+    if (!file.Open(path)) {
+        std::fprintf(stderr, "Unable to open file %s. Exiting...\n", path);
+        return -2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::size_t> cases;
+    if (opcode_ranges.empty()) {
+        cases.resize(file.NumCases());
+        std::iota(cases.begin(), cases.end(), std::size_t{0});
+    } else {
+        cases = file.Select(opcode_ranges);
+    }
+    const std::size_t num_cases = cases.size();
+    std::vector<Chunk> chunks((num_cases + ChunkSize - 1) / ChunkSize);
+    // No more threads than chunks, but at least the main thread
+    threads = static_cast<unsigned>(std::clamp<std::size_t>(chunks.size(), 1, threads));
+    std::atomic<std::size_t> next_chunk{0};
+    const auto worker = [&] {
+        auto core = std::make_unique<Core>();
+        for (std::size_t c; (c = next_chunk.fetch_add(1)) < chunks.size();) {
+            Chunk& chunk = chunks[c];
+            const std::size_t end = std::min(num_cases, (c + 1) * ChunkSize);
+            for (std::size_t n = c * ChunkSize; n < end; ++n) {
+                const std::size_t i = cases[n];
+                switch (Verify(*core, file.Get(i), i, use_jit, chunk.output)) {
+                case Outcome::Pass:
+                    ++chunk.passed;
+                    break;
+                case Outcome::Fail:
+                    chunk.failed.push_back(i);
+                    break;
+                case Outcome::Skip:
+                    chunk.skipped.push_back(i);
+                    break;
+                }
             }
         }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-        ++i;
+    std::size_t passed = 0;
+    std::vector<std::size_t> failed, skipped;
+    for (const Chunk& chunk : chunks) {
+        std::fputs(chunk.output.c_str(), stdout);
+        passed += chunk.passed;
+        failed.insert(failed.end(), chunk.failed.begin(), chunk.failed.end());
+        skipped.insert(skipped.end(), chunk.skipped.begin(), chunk.skipped.end());
     }
+    const std::size_t total = passed + failed.size();
+    std::printf("%zu / %zu passed, %zu skipped\n", passed, total, skipped.size());
 
-    std::printf("%d / %d passed, %d skipped\n", passed, total, skipped);
+    if (json_path) {
+        std::unique_ptr<std::FILE, fclose_deleter> json{std::fopen(json_path, "w")};
+        if (!json) {
+            std::fprintf(stderr, "Unable to write %s\n", json_path);
+            return -2;
+        }
+        std::fprintf(json.get(), "{\n");
+        std::fprintf(json.get(), "  \"file\": %s,\n", JsonString(path).c_str());
+        std::fprintf(json.get(), "  \"engine\": \"%s\",\n", use_jit ? "jit" : "interpreter");
+        std::fprintf(json.get(), "  \"threads\": %u,\n", threads);
+        std::fprintf(json.get(), "  \"seconds\": %.3f,\n", elapsed.count());
+        std::fprintf(json.get(), "  \"cases\": %zu,\n", num_cases);
+        std::fprintf(json.get(), "  \"passed\": %zu,\n", passed);
+        std::fprintf(json.get(), "  \"failed\": %zu,\n", failed.size());
+        std::fprintf(json.get(), "  \"skipped\": %zu,\n", skipped.size());
+        WriteIndices(json.get(), "failed_cases", failed);
+        std::fprintf(json.get(), ",\n");
+        WriteIndices(json.get(), "skipped_cases", skipped);
+        std::fprintf(json.get(), "\n}\n");
+    }
 
     if (passed < total) {
         return 1;
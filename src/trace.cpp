@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include "crash.h"
+#include "trace.h"
+
+namespace Teakra {
+
+namespace {
+// Tracers to write out when an assertion fails
+std::mutex crash_mutex;
+std::vector<Tracer*> crash_tracers;
+} // Anonymous namespace
+
+Tracer::Tracer() = default;
+
+Tracer::~Tracer() {
+    Stop();
+}
+
+void Tracer::Start(std::size_t capacity, std::span<const u8> program_, std::string crash_path_) {
+    Stop();
+    capacity = std::bit_ceil(std::max<std::size_t>(capacity, 1));
+    events = std::make_unique<TraceEvent[]>(capacity);
+    mask = capacity - 1;
+    head.store(0, std::memory_order_relaxed);
+    now = 0;
+    in_interrupt = false;
+    program = program_;
+    crash_path = std::move(crash_path_);
+    if (!crash_path.empty()) {
+        std::lock_guard lock(crash_mutex);
+        crash_tracers.push_back(this);
+        crash_hook = &Tracer::DumpOnCrash;
+    }
+}
+
+void Tracer::Stop() {
+    std::lock_guard lock(crash_mutex);
+    crash_tracers.erase(std::remove(crash_tracers.begin(), crash_tracers.end(), this),
+                        crash_tracers.end());
+}
+
+std::vector<TraceEvent> Tracer::Snapshot(u64& first) const {
+    std::vector<TraceEvent> result;
+    const u64 end = head.load(std::memory_order_acquire);
+    const u64 capacity = events ? mask + 1 : 0;
+    first = end > capacity ? end - capacity : 0;
+    for (u64 i = first; i < end; ++i) {
+        result.push_back(events[i & mask]);
+    }
+    // Drop what the DSP thread may have overwritten while copying, including the slot of the
+    // event it may be writing now
+    const u64 written = head.load(std::memory_order_acquire);
+    if (written + 1 > first + capacity) {
+        const u64 lost = std::min<u64>(written + 1 - capacity - first, result.size());
+        result.erase(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(lost));
+        first += lost;
+    }
+    return result;
+}
+
+bool Tracer::Write(const std::string& path) const {
+    u64 first;
+    const auto snapshot = Snapshot(first);
+    TraceFileHeader header{};
+    header.magic = TraceMagic;
+    header.version = TraceVersion;
+    header.first = first;
+    header.count = snapshot.size();
+    header.program_words = static_cast<u32>(program.size() / sizeof(u16));
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(snapshot.data()),
+               static_cast<std::streamsize>(snapshot.size() * sizeof(TraceEvent)));
+    file.write(reinterpret_cast<const char*>(program.data()),
+               static_cast<std::streamsize>(header.program_words * sizeof(u16)));
+    return file.good();
+}
+
+void Tracer::DumpOnCrash() {
+    // Not locking: the failed assertion may have happened with the lock held
+    for (const Tracer* tracer : crash_tracers) {
+        if (tracer->Write(tracer->crash_path)) {
+            std::fprintf(stderr, "\nExecution trace written to %s\n", tracer->crash_path.c_str());
+        }
+    }
+}
+
+} // namespace Teakra
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "common_types.h"
+
+namespace Teakra {
+
+enum class TraceEventType : u8 {
+    Instruction,    // interpreter: address = pc, before executing it
+    Block,          // JIT: address = pc of the block entered, value = variant at that pc
+    Idle,           // address = pc; the cycles until the next event were skipped
+    InterruptEnter, // address = handler, value = interrupt 0-2, or 3 for vectored
+    InterruptExit,  // address = pc returned to
+    MMIORead,       // address = MMIO offset, value = value read
+    MMIOWrite,      // address = MMIO offset, value = value written
+    DmaStart,       // address = channel, value = src_space << 8 | dst_space
+    DmaFinish,      // address = channel
+    BtdmpUnderrun,  // address = port; a sample was due with the transmit queue empty
+    BtdmpOverrun,   // address = port; a word was sent with the transmit queue full
+};
+
+struct TraceEvent {
+    u64 cycle;
+    u32 address;
+    u16 value;
+    TraceEventType type;
+    u8 reserved;
+};
+static_assert(sizeof(TraceEvent) == 16);
+
+// Trace file layout, in host byte order: TraceFileHeader, `count` TraceEvent from the oldest,
+// then `program_words` u16 of program memory as it was when the trace was written
+struct TraceFileHeader {
+    u32 magic;
+    u32 version;
+    u64 first; // sequence number of the first event; the ones before it were overwritten
+    u64 count;
+    u32 program_words;
+    u32 reserved;
+};
+
+constexpr u32 TraceMagic = 0x52544B54; // "TKTR"
+constexpr u32 TraceVersion = 1;
+
+/// Execution trace in a fixed size ring buffer; the newest events overwrite the oldest.
+///
+/// Events are recorded by the thread running the DSP, without locking. The buffer may be read
+/// from any thread meanwhile, in which case events being overwritten during the copy are left out.
+/// Cycles count from Start; in JIT blocks, accesses are stamped with the cycle of the block entry.
+class Tracer {
+public:
+    Tracer();
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /// Discards the events of any previous run. `capacity` is rounded up to a power of two.
+    /// If `crash_path` is not empty, the trace is written there when an assertion fails.
+    void Start(std::size_t capacity, std::span<const u8> program, std::string crash_path);
+    void Stop();
+
+    void Record(TraceEventType type, u32 address, u16 value = 0) {
+        const u64 index = head.load(std::memory_order_relaxed);
+        events[index & mask] = {now, address, value, type, 0};
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    void Instruction(u32 pc) {
+        Record(TraceEventType::Instruction, pc);
+        ++now;
+    }
+
+    void Advance(u64 cycles) {
+        now += cycles;
+    }
+
+    /// The buffered events, oldest first. `first` receives the sequence number of the first one.
+    std::vector<TraceEvent> Snapshot(u64& first) const;
+
+    bool Write(const std::string& path) const;
+
+    /// Set between an interrupt entry and its exit. The JIT sees the exit at the end of the block
+    /// where interrupts come back on.
+    bool in_interrupt = false;
+
+private:
+    static void DumpOnCrash();
+
+    std::unique_ptr<TraceEvent[]> events;
+    u64 mask = 0;
+    std::atomic<u64> head{0};
+    u64 now = 0;
+    std::span<const u8> program;
+    std::string crash_path;
+};
+
+} // namespace Teakra
@@ -0,0 +1,163 @@
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <teakra/disassembler.h>
+#include "../common_types.h"
+#include "../trace.h"
+
+namespace {
+
+struct fclose_deleter {
+    void operator()(std::FILE* f) const {
+        std::fclose(f);
+    }
+};
+
+using Teakra::TraceEvent;
+using Teakra::TraceEventType;
+
+const char* const TypeNames[] = {
+    "insn", "block", "idle", "irq", "reti", "mmio_r", "mmio_w", "dma", "dma_end", "underrun",
+    "overrun",
+};
+
+std::string Disassemble(const std::vector<u16>& program, u32 pc) {
+    if (pc >= program.size()) {
+        return "(outside the program memory)";
+    }
+    const u16 opcode = program[pc];
+    const u16 expansion = Teakra::Disassembler::NeedExpansion(opcode) && pc + 1 < program.size()
+                              ? program[pc + 1]
+                              : 0;
+    return Teakra::Disassembler::Do(opcode, expansion);
+}
+
+void Usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--last n] [--no-instructions] trace_file\n"
+                 "  --last             only print the last n events\n"
+                 "  --no-instructions  leave out instructions and blocks, but keep the counts\n",
+                 program);
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    u64 last = 0;
+    bool instructions = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--last" && i + 1 < argc) {
+            last = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--no-instructions") {
+            instructions = false;
+        } else if (!path && arg[0] != '-') {
+            path = argv[i];
+        } else {
+            Usage(argv[0]);
+            return -1;
+        }
+    }
+    if (!path) {
+        Usage(argv[0]);
+        return -1;
+    }
+
+    std::unique_ptr<std::FILE, fclose_deleter> file{std::fopen(path, "rb")};
+    if (!file) {
+        std::fprintf(stderr, "Unable to open %s\n", path);
+        return -2;
+    }
+    Teakra::TraceFileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file.get()) != 1 ||
+        header.magic != Teakra::TraceMagic || header.version != Teakra::TraceVersion) {
+        std::fprintf(stderr, "%s is not a trace file\n", path);
+        return -2;
+    }
+    std::vector<TraceEvent> events(header.count);
+    std::vector<u16> program(header.program_words);
+    if (std::fread(events.data(), sizeof(TraceEvent), events.size(), file.get()) !=
+            events.size() ||
+        std::fread(program.data(), sizeof(u16), program.size(), file.get()) != program.size()) {
+        std::fprintf(stderr, "%s is truncated\n", path);
+        return -2;
+    }
+
+    std::array<u64, std::size(TypeNames)> counts{};
+    const u64 skip = last != 0 && last < events.size() ? events.size() - last : 0;
+    if (header.first != 0) {
+        std::printf("(%" PRIu64 " earlier events were overwritten)\n", header.first);
+    }
+    std::printf("%8s %12s  %-8s\n", "event", "cycle", "type");
+    for (u64 i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        const auto type = static_cast<std::size_t>(event.type);
+        if (type >= counts.size()) {
+            std::fprintf(stderr, "unknown event type %zu\n", type);
+            return -2;
+        }
+        ++counts[type];
+        if (i < skip || (!instructions && (event.type == TraceEventType::Instruction ||
+                                           event.type == TraceEventType::Block))) {
+            continue;
+        }
+
+        std::printf("%8" PRIu64 " %12" PRIu64 "  %-8s  ", header.first + i, event.cycle,
+                    TypeNames[type]);
+        switch (event.type) {
+        case TraceEventType::Instruction:
+            std::printf("%05X  %s\n", event.address,
+                        Disassemble(program, event.address).c_str());
+            break;
+        case TraceEventType::Block:
+            std::printf("%05X  %s  (variant %u)\n", event.address,
+                        Disassemble(program, event.address).c_str(), event.value);
+            break;
+        case TraceEventType::Idle:
+            std::printf("%05X\n", event.address);
+            break;
+        case TraceEventType::InterruptEnter:
+            if (event.value == 3) {
+                std::printf("vectored -> %05X\n", event.address);
+            } else {
+                std::printf("int%u -> %05X\n", event.value, event.address);
+            }
+            break;
+        case TraceEventType::InterruptExit:
+            std::printf("-> %05X\n", event.address);
+            break;
+        case TraceEventType::MMIORead:
+            std::printf("[%03X] -> %04X\n", event.address, event.value);
+            break;
+        case TraceEventType::MMIOWrite:
+            std::printf("[%03X] <- %04X\n", event.address, event.value);
+            break;
+        case TraceEventType::DmaStart:
+            std::printf("channel %u, space %u -> %u\n", event.address, event.value >> 8,
+                        event.value & 0xFF);
+            break;
+        case TraceEventType::DmaFinish:
+            std::printf("channel %u\n", event.address);
+            break;
+        case TraceEventType::BtdmpUnderrun:
+        case TraceEventType::BtdmpOverrun:
+            std::printf("btdmp%u\n", event.address);
+            break;
+        }
+    }
+
+    std::printf("\n%" PRIu64 " events:", static_cast<u64>(events.size()));
+    for (std::size_t type = 0; type < counts.size(); ++type) {
+        if (counts[type] != 0) {
+            std::printf(" %s %" PRIu64, TypeNames[type], counts[type]);
+        }
+    }
+    std::printf("\n");
+    return 0;
+}
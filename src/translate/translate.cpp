@@ -1 +1,337 @@
-#include "translate.h"
+#include "translate/translate.h"
+#include "decoder.h"
+#include "ir/basic_block.h"
+#include "ir/ir_emitter.h"
+#include "operand.h"
+
+namespace Teakra::IR {
+
+namespace {
+
+bool IsAcc(RegName reg) {
+    switch (reg) {
+    case RegName::a0:
+    case RegName::a1:
+    case RegName::b0:
+    case RegName::b1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool IsAccLow(RegName reg) {
+    switch (reg) {
+    case RegName::a0l:
+    case RegName::a1l:
+    case RegName::b0l:
+    case RegName::b1l:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool IsAccHigh(RegName reg) {
+    switch (reg) {
+    case RegName::a0h:
+    case RegName::a1h:
+    case RegName::b0h:
+    case RegName::b1h:
+        return true;
+    default:
+        return false;
+    }
+}
+
+RegName FullAcc(RegName reg) {
+    switch (reg) {
+    case RegName::a0:
+    case RegName::a0l:
+    case RegName::a0h:
+        return RegName::a0;
+    case RegName::a1:
+    case RegName::a1l:
+    case RegName::a1h:
+        return RegName::a1;
+    case RegName::b0:
+    case RegName::b0l:
+    case RegName::b0h:
+        return RegName::b0;
+    case RegName::b1:
+    case RegName::b1l:
+    case RegName::b1h:
+        return RegName::b1;
+    default:
+        UNREACHABLE();
+    }
+}
+
+// 16-bit registers that are plain storage: reading and writing them has no further effects and
+// does not change the static state a block is compiled for.
+bool IsPlainRegister(RegName reg) {
+    switch (reg) {
+    case RegName::r0:
+    case RegName::r1:
+    case RegName::r2:
+    case RegName::r3:
+    case RegName::r4:
+    case RegName::r5:
+    case RegName::r6:
+    case RegName::r7:
+    case RegName::y0:
+    case RegName::sv:
+    case RegName::sp:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool CanReadBus16(RegName reg) {
+    return IsPlainRegister(reg) || IsAcc(reg) || IsAccLow(reg) || IsAccHigh(reg);
+}
+
+bool CanWriteBus16(RegName reg) {
+    return CanReadBus16(reg);
+}
+
+bool IsBitwise(AlmOp op) {
+    return op == AlmOp::Or || op == AlmOp::And || op == AlmOp::Xor;
+}
+
+} // Anonymous namespace
+
+/// Translates Teak instructions to IR. Handlers return false, without emitting anything, for
+/// instructions that are not supported yet.
+class TranslatorVisitor final {
+public:
+    using instruction_return_type = bool;
+
+    explicit TranslatorVisitor(Block& block)
+        : ir(block, block.Location()), state(block.EntryState()) {}
+
+    IREmitter ir;
+    const StaticRegs& state;
+
+#define UNSUPPORTED(name)                                                                          \
+    template <typename... Args>                                                                    \
+    bool name(Args...) {                                                                           \
+        return false;                                                                              \
+    }
+#include "translate/unsupported.inc"
+#undef UNSUPPORTED
+
+    bool undefined(u16 opcode) {
+        return false;
+    }
+
+    bool nop() {
+        return true;
+    }
+
+    bool mov(Register a, Register b) {
+        // p and pc as a source have special meanings
+        if (!CanReadBus16(a.GetName()) || !CanWriteBus16(b.GetName())) {
+            return false;
+        }
+        RegFromBus16(b.GetName(), RegToBus16(a.GetName(), true));
+        return true;
+    }
+    bool mov(Imm16 a, Register b) {
+        if (!CanWriteBus16(b.GetName())) {
+            return false;
+        }
+        RegFromBus16(b.GetName(), ir.Imm16(a.Unsigned16()));
+        return true;
+    }
+    bool mov(Imm16 a, Bx b) {
+        RegFromBus16(b.GetName(), ir.Imm16(a.Unsigned16()));
+        return true;
+    }
+    bool mov(Imm8s a, RnOld b) {
+        RegFromBus16(b.GetName(), ir.Imm16(a.Signed16()));
+        return true;
+    }
+    bool mov(Imm8s a, Axh b) {
+        RegFromBus16(b.GetName(), ir.Imm16(a.Signed16()));
+        return true;
+    }
+    bool mov(Imm8 a, Axl b) {
+        RegFromBus16(b.GetName(), ir.Imm16(a.Unsigned16()));
+        return true;
+    }
+    bool mov_sv(Imm8s a) {
+        ir.SetRegister16(RegName::sv, ir.Imm16(a.Signed16()));
+        return true;
+    }
+
+    bool mov(MemImm16 a, Ax b) {
+        RegFromBus16(b.GetName(), ir.ReadMemory16(ir.Imm16(a.Unsigned16())));
+        return true;
+    }
+    bool mov(MemImm8 a, Ab b) {
+        RegFromBus16(b.GetName(), ir.ReadMemory16(PageAddress(a)));
+        return true;
+    }
+    bool mov(MemImm8 a, Ablh b) {
+        RegFromBus16(b.GetName(), ir.ReadMemory16(PageAddress(a)));
+        return true;
+    }
+    bool mov(MemImm8 a, RnOld b) {
+        RegFromBus16(b.GetName(), ir.ReadMemory16(PageAddress(a)));
+        return true;
+    }
+    bool mov_sv(MemImm8 a) {
+        ir.SetRegister16(RegName::sv, ir.ReadMemory16(PageAddress(a)));
+        return true;
+    }
+
+    bool mov(Axl a, MemImm16 b) {
+        ir.WriteMemory16(ir.Imm16(b.Unsigned16()), RegToBus16(a.GetName(), true));
+        return true;
+    }
+    bool mov(Ablh a, MemImm8 b) {
+        ir.WriteMemory16(PageAddress(b), RegToBus16(a.GetName(), true));
+        return true;
+    }
+    bool mov(RnOld a, MemImm8 b) {
+        ir.WriteMemory16(PageAddress(b), RegToBus16(a.GetName()));
+        return true;
+    }
+    bool mov_sv_to(MemImm8 b) {
+        ir.WriteMemory16(PageAddress(b), ir.GetRegister16(RegName::sv));
+        return true;
+    }
+
+    bool alu(Alu op, Imm16 a, Ax b) {
+        if (!IsBitwise(op.GetName())) {
+            return false;
+        }
+        AlmBitwise(op.GetName(), ir.Imm64(a.Unsigned16()), b.GetName());
+        return true;
+    }
+    bool alm(Alm op, MemImm8 a, Ax b) {
+        if (!IsBitwise(op.GetName())) {
+            return false;
+        }
+        AlmBitwise(op.GetName(), ir.ZeroExtend16To64(ir.ReadMemory16(PageAddress(a))),
+                   b.GetName());
+        return true;
+    }
+    bool alm(Alm op, Register a, Ax b) {
+        // 40-bit operands (p, a0, a1) are not handled yet
+        if (!IsBitwise(op.GetName()) || !IsPlainRegister(a.GetName())) {
+            return false;
+        }
+        AlmBitwise(op.GetName(), ir.ZeroExtend16To64(RegToBus16(a.GetName())), b.GetName());
+        return true;
+    }
+
+private:
+    U16 PageAddress(Imm8 address) {
+        return ir.Imm16(static_cast<u16>(address.Unsigned16() + (state.page << 8)));
+    }
+
+    U64 SaturateAcc(const U64& value) {
+        return ir.SaturateAcc(value, true);
+    }
+
+    U64 GetAndSatAcc(RegName name) {
+        U64 value = ir.GetAcc(FullAcc(name));
+        if (!state.sat) {
+            value = SaturateAcc(value);
+        }
+        return value;
+    }
+
+    void SatAndSetAccAndFlag(RegName name, U64 value) {
+        ir.SetAccFlag(value);
+        if (!state.sata) {
+            value = SaturateAcc(value);
+        }
+        ir.SetAcc(FullAcc(name), value);
+    }
+
+    void SetAccAndFlag(RegName name, const U64& value) {
+        ir.SetAccFlag(value);
+        ir.SetAcc(FullAcc(name), value);
+    }
+
+    U16 RegToBus16(RegName reg, bool enable_sat_for_mov = false) {
+        if (IsAcc(reg)) {
+            // Like aXl, but never saturates
+            return ir.ExtractHalf64(ir.GetAcc(reg), 0);
+        }
+        if (IsAccLow(reg) || IsAccHigh(reg)) {
+            const U64 value = enable_sat_for_mov ? GetAndSatAcc(reg) : ir.GetAcc(FullAcc(reg));
+            return ir.ExtractHalf64(value, IsAccHigh(reg) ? 1 : 0);
+        }
+        ASSERT(IsPlainRegister(reg));
+        return ir.GetRegister16(reg);
+    }
+
+    void RegFromBus16(RegName reg, const U16& value) {
+        if (IsAcc(reg)) {
+            SatAndSetAccAndFlag(reg, ir.SignExtend64(ir.ZeroExtend16To64(value), 16));
+        } else if (IsAccLow(reg)) {
+            SatAndSetAccAndFlag(reg, ir.ZeroExtend16To64(value));
+        } else if (IsAccHigh(reg)) {
+            const U64 high = ir.LogicalShiftLeft64(ir.ZeroExtend16To64(value), ir.Imm8(16));
+            SatAndSetAccAndFlag(reg, ir.SignExtend64(high, 32));
+        } else {
+            ASSERT(IsPlainRegister(reg));
+            ir.SetRegister16(reg, value);
+        }
+    }
+
+    void AlmBitwise(AlmOp op, const U64& a, RegName b) {
+        const U64 acc = ir.GetAcc(b);
+        U64 value;
+        switch (op) {
+        case AlmOp::Or:
+            value = ir.Or64(acc, a);
+            break;
+        case AlmOp::And:
+            value = ir.And64(acc, a);
+            break;
+        case AlmOp::Xor:
+            value = ir.Xor64(acc, a);
+            break;
+        default:
+            UNREACHABLE();
+        }
+        SetAccAndFlag(b, ir.SignExtend64(value, 40));
+    }
+};
+
+u32 Translate(Block& block, const std::function<u16(u32)>& program_read,
+              const std::function<bool(u32)>& stop_before, u32 max_instructions) {
+    static const auto decoders = GetDecoderTable<TranslatorVisitor>();
+
+    TranslatorVisitor visitor{block};
+    u32 pc = static_cast<u32>(block.Location().Value());
+    u32 count = 0;
+    while (count < max_instructions && !stop_before(pc)) {
+        const u16 opcode = program_read(pc);
+        const auto& decoder = decoders[opcode];
+        u16 expand_value = 0;
+        if (decoder.NeedExpansion()) {
+            expand_value = program_read(pc + 1);
+        }
+
+        visitor.ir.SetPC(pc);
+        if (!decoder.call(visitor, opcode, expand_value)) {
+            break;
+        }
+
+        pc += decoder.NeedExpansion() ? 2 : 1;
+        block.CycleCount()++;
+        count++;
+    }
+
+    block.SetEndLocation(LocationDescriptor{pc});
+    return count;
+}
+
+} // namespace Teakra::IR
@@ -0,0 +1,82 @@
+#include <array>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/btdmp.h"
+#include "../src/common_types.h"
+
+TEST_CASE("Program block transfers", "[api]") {
+    Teakra::Teakra teakra;
+    const std::array<u16, 4> data{0x1111, 0x2222, 0x3333, 0x4444};
+    std::array<u16, 4> out{};
+
+    REQUIRE(teakra.ProgramWriteBlock(0x100, data));
+    REQUIRE(teakra.ProgramReadBlock(0x100, out));
+    REQUIRE(out == data);
+    REQUIRE(teakra.ProgramRead(0x103) == 0x4444);
+
+    // The last words of the program memory are fine, one past them would be data memory
+    REQUIRE(teakra.ProgramWriteBlock(0x1FFFC, data));
+    REQUIRE(!teakra.ProgramWriteBlock(0x1FFFD, data));
+    REQUIRE(!teakra.ProgramReadBlock(0x1FFFD, out));
+    REQUIRE(!teakra.ProgramWriteBlock(0xFFFFFFFF, data));
+    REQUIRE(teakra.ProgramRead(0x1FFFF) == 0x4444);
+    REQUIRE(teakra.DataRead(0x0000) == 0);
+}
+
+TEST_CASE("Data block transfers wrap", "[api]") {
+    Teakra::Teakra teakra;
+    const std::array<u16, 4> data{0x1111, 0x2222, 0x3333, 0x4444};
+    teakra.DataWriteBlock(0x1FFFE, data);
+    REQUIRE(teakra.DataReadA32(0x1FFFF) == 0x2222);
+    REQUIRE(teakra.DataReadA32(0x0000) == 0x3333);
+
+    std::array<u16, 4> out{};
+    teakra.DataReadBlock(0x1FFFE, out);
+    REQUIRE(out == data);
+}
+
+TEST_CASE("RunUntil", "[api]") {
+    const std::array<u16, 6> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // loop: inc a0
+        0x1B40,         // mov a0l, [r0]
+        0x4180, 0x0002, // br loop
+    };
+    Teakra::Teakra teakra;
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+    teakra.ProgramWriteBlock(0, program);
+
+    // Checked between slices only
+    const u32 elapsed = teakra.RunUntil(1000, 10, [&] { return teakra.DataRead(0x1000) >= 10; });
+    REQUIRE(elapsed % 10 == 0);
+    REQUIRE(elapsed < 1000);
+    REQUIRE(teakra.DataRead(0x1000) >= 10);
+    REQUIRE(teakra.DataRead(0x1000) < 10 + 10);
+
+    REQUIRE(teakra.RunUntil(95, 10, [] { return false; }) == 95);
+}
+
+TEST_CASE("Audio blocks are flushed when output stops", "[api]") {
+    Teakra::Btdmp btdmp;
+    std::vector<std::size_t> block_sizes;
+    btdmp.SetInterruptHandler([] {});
+    btdmp.SetAudioBlockCallback(
+        4, [&](std::span<const std::int16_t> samples) { block_sizes.push_back(samples.size()); });
+    btdmp.SetTransmitPeriod(10);
+    btdmp.SetTransmitEnable(1);
+
+    for (u16 i = 0; i < 12; ++i) {
+        btdmp.Send(i);
+    }
+    btdmp.Tick(60);
+    REQUIRE(block_sizes == std::vector<std::size_t>{8});
+
+    // The two frames of the next block so far are delivered when the DSP stops the output
+    btdmp.SetTransmitEnable(0);
+    REQUIRE(block_sizes == std::vector<std::size_t>{8, 4});
+
+    btdmp.Reset();
+    REQUIRE(block_sizes.size() == 2);
+}
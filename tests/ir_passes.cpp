@@ -0,0 +1,113 @@
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include "../src/common_types.h"
+#include "../src/ir/basic_block.h"
+#include "../src/ir/ir_emitter.h"
+#include "../src/ir/opcode.h"
+#include "../src/ir/opt/passes.h"
+#include "../src/operand.h"
+
+using namespace Teakra;
+
+namespace {
+
+// Drops the instructions a pass has turned into Identity or Void, checks the block and lists the
+// opcodes that are left
+std::vector<IR::Opcode> Finish(IR::Block& block) {
+    Optimization::IdentityRemoval(block);
+    Optimization::NamingPass(block);
+    Optimization::VerificationPass(block);
+    std::vector<IR::Opcode> opcodes;
+    for (const IR::Inst& inst : block) {
+        opcodes.push_back(inst.GetOpcode());
+    }
+    return opcodes;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("GetSetElimination forwards register values", "[ir]") {
+    IR::Block block{IR::LocationDescriptor{0}};
+    IR::IREmitter ir{block, block.Location()};
+    ir.SetRegister16(RegName::r0, ir.Imm16(5));
+    ir.SetRegister16(RegName::r1, ir.GetRegister16(RegName::r0));
+    ir.SetRegister16(RegName::r0, ir.Imm16(6));
+    const auto first = ir.GetRegister16(RegName::r2);
+    const auto second = ir.GetRegister16(RegName::r2);
+    ir.SetRegister16(RegName::r3, ir.Add16(first, second));
+
+    Optimization::GetSetElimination(block);
+    // The first store to r0 is overwritten before any read, and the reads are forwarded
+    REQUIRE(Finish(block) == std::vector{IR::Opcode::SetRegister16, IR::Opcode::SetRegister16,
+                                         IR::Opcode::GetRegister16, IR::Opcode::Add16,
+                                         IR::Opcode::SetRegister16});
+    auto iter = block.begin();
+    REQUIRE(iter->GetArg(0).GetRegName() == RegName::r1);
+    REQUIRE(iter->GetArg(1).IsImmediate());
+    REQUIRE(iter->GetArg(1).GetU16() == 5);
+    ++iter;
+    REQUIRE(iter->GetArg(0).GetRegName() == RegName::r0);
+    REQUIRE(iter->GetArg(1).GetU16() == 6);
+    ++iter;
+    const IR::Inst* get = &*iter;
+    ++iter;
+    REQUIRE(iter->GetArg(0).GetInst() == get);
+    REQUIRE(iter->GetArg(1).GetInst() == get);
+    REQUIRE(get->UseCount() == 2);
+}
+
+TEST_CASE("DeadFlagElimination keeps the last flag update", "[ir]") {
+    IR::Block block{IR::LocationDescriptor{0}};
+    IR::IREmitter ir{block, block.Location()};
+    const auto acc = ir.GetAcc(RegName::a0);
+    ir.SetAccFlag(acc);
+    const auto result = ir.Or64(acc, ir.Imm64(1));
+    ir.SetAcc(RegName::a0, result);
+    ir.SetAccFlag(result);
+
+    Optimization::DeadFlagElimination(block);
+    REQUIRE(Finish(block) == std::vector{IR::Opcode::GetAcc, IR::Opcode::Or64,
+                                         IR::Opcode::SetAcc, IR::Opcode::SetAccFlag});
+    REQUIRE(block.back().GetArg(0).GetInst()->GetOpcode() == IR::Opcode::Or64);
+}
+
+TEST_CASE("ConstantFolding evaluates known values", "[ir]") {
+    IR::Block block{IR::LocationDescriptor{0}};
+    IR::IREmitter ir{block, block.Location()};
+    const auto extended = ir.ZeroExtend16To64(ir.Imm16(0x1234));
+    const auto shifted = ir.LogicalShiftLeft64(extended, ir.Imm8(16));
+    ir.SetAcc(RegName::a0, ir.Or64(shifted, ir.Imm64(0)));
+    ir.SetAcc(RegName::a1, ir.And64(ir.GetAcc(RegName::a1), ir.Imm64(~u64{0})));
+    ir.SetAcc(RegName::b0, ir.SaturateAcc(ir.Imm64(0x12'3456'7890), false));
+    // Saturating with flm has an effect at run time, so it stays
+    ir.SetAcc(RegName::b1, ir.SaturateAcc(ir.Imm64(0x12'3456'7890), true));
+
+    Optimization::ConstantFolding(block);
+    REQUIRE(Finish(block) == std::vector{IR::Opcode::SetAcc, IR::Opcode::GetAcc,
+                                         IR::Opcode::SetAcc, IR::Opcode::SetAcc,
+                                         IR::Opcode::SaturateAcc, IR::Opcode::SetAcc});
+    auto iter = block.begin();
+    REQUIRE(iter->GetArg(1).IsImmediate());
+    REQUIRE(iter->GetArg(1).GetU64() == 0x1234'0000);
+    ++iter;
+    const IR::Inst* get = &*iter;
+    ++iter;
+    REQUIRE(iter->GetArg(1).GetInst() == get);
+    ++iter;
+    REQUIRE(iter->GetArg(1).GetU64() == 0x7FFF'FFFF);
+}
+
+TEST_CASE("DeadCodeElimination removes unused values without side effects", "[ir]") {
+    IR::Block block{IR::LocationDescriptor{0}};
+    IR::IREmitter ir{block, block.Location()};
+    ir.ZeroExtend16To64(ir.GetRegister16(RegName::r0));
+    // Reads may hit MMIO, so they stay even when unused
+    ir.ReadMemory16(ir.Imm16(0x8000));
+    ir.SetRegister16(RegName::r2, ir.GetRegister16(RegName::r1));
+
+    Optimization::DeadCodeElimination(block);
+    REQUIRE(Finish(block) == std::vector{IR::Opcode::ReadMemory16, IR::Opcode::GetRegister16,
+                                         IR::Opcode::SetRegister16});
+    REQUIRE(block.front().GetArg(0).GetU16() == 0x8000);
+    REQUIRE(block.back().GetArg(0).GetRegName() == RegName::r2);
+}
@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <span>
+#include <utility>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/common_types.h"
+
+namespace {
+
+void LoadProgram(Teakra::Teakra& teakra, std::span<const u16> program) {
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+    teakra.ProgramWriteBlock(0, program);
+}
+
+} // Anonymous namespace
+
+TEST_CASE("rep resumed at a block compiled before the rep", "[jit]") {
+    const std::array<u16, 15> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0xCD00,         // cmp 0x0000u8, a1
+        0x4181, 0x0008, // br target, eq
+        0x0CFF,         // again: rep 0x00ffu8
+        0x67D0,         // target: inc a0
+        0x77D0,         // inc a1
+        0xCD01,         // cmp 0x0001u8, a1
+        0x4181, 0x0007, // br again, eq
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    Teakra::Teakra teakra(true);
+    LoadProgram(teakra, program);
+
+    // Short slices make the rep loop leave its block halfway and resume at `target`, which
+    // already has a block compiled from the first pass
+    for (int i = 0; i < 100; ++i) {
+        teakra.Run(16);
+    }
+    REQUIRE(teakra.DataRead(0x1000) == 1 + 0x100);
+}
+
+TEST_CASE("bkrep body split across run slices", "[jit]") {
+    const std::array<u16, 9> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x5CFF, 0x0007, // bkrep 0x00ffu8, end
+        0x67D0,         // inc a0
+        0x1B48,         // end: mov a0l, [r0++]
+        0x57F0,         // brr -1
+    };
+    Teakra::Teakra teakra(true);
+    LoadProgram(teakra, program);
+
+    // The in-block loop has to leave at every slice boundary and resume where it left off
+    for (int i = 0; i < 100; ++i) {
+        teakra.Run(16);
+    }
+    std::array<u16, 0x100> results{};
+    teakra.DataReadBlock(0x1000, results);
+    for (u16 i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i] == i + 1);
+    }
+    REQUIRE(teakra.DataRead(0x1100) == 0);
+}
+
+TEST_CASE("Flags live across a ret followed by a flag-setting instruction", "[jit]") {
+    const std::array<u16, 17> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0xCD00,         // cmp 0x0000u8, a1
+        0x41C1, 0x000D, // call sub, eq
+        0x4182, 0x000B, // br nonzero, neq
+        0x1B60,         // mov a1l, [r0]
+        0x57F0,         // brr -1
+        0x1B40,         // nonzero: mov a0l, [r0]
+        0x57F0,         // brr -1
+        0x67D0,         // sub: inc a0
+        0x4580,         // ret
+        0x5E18, 0x0000, // mov 0x0000, a0
+    };
+    Teakra::Teakra teakra(true);
+    LoadProgram(teakra, program);
+
+    // The instruction after the ret sets every flag, but the caller sees the ones of `inc a0`
+    teakra.Run(100);
+    REQUIRE(teakra.DataRead(0x1000) == 1);
+}
+
+TEST_CASE("Precompile list round trip", "[jit]") {
+    const std::array<u16, 6> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // inc a0
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+        0x0000,         // nop
+    };
+    const auto path = std::filesystem::temp_directory_path() / "teakra_precompile.list";
+    {
+        Teakra::Teakra teakra(true);
+        LoadProgram(teakra, program);
+        teakra.Run(10);
+        REQUIRE(teakra.SavePrecompileList(path.string()));
+    }
+
+    Teakra::Teakra teakra(true);
+    LoadProgram(teakra, program);
+    REQUIRE(teakra.LoadPrecompileList(path.string()));
+    teakra.Run(10);
+    REQUIRE(teakra.DataRead(0x1000) == 1);
+
+    // Lists are tied to the program image they were saved with
+    teakra.ProgramWrite(5, 0x0001);
+    REQUIRE(!teakra.LoadPrecompileList(path.string()));
+
+    Teakra::Teakra interpreter;
+    REQUIRE(!interpreter.SavePrecompileList(path.string()));
+    REQUIRE(!interpreter.LoadPrecompileList(path.string()));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Tiered compilation leaves code that runs once to the interpreter", "[jit]") {
+    const std::array<u16, 14> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // loop: inc a0
+        0x41C0, 0x000C, // call sub
+        0x1B48,         // mov a0l, [r0++]
+        0xCC30,         // cmp 0x0030u8, a0
+        0x4182, 0x0004, // br loop, neq
+        0x57F0,         // brr -1
+        0xC602,         // sub: add 0x0002u8, a0
+        0x4580,         // ret
+    };
+    Teakra::Teakra teakra(true);
+    teakra.SetTieredCompilation(true);
+    LoadProgram(teakra, program);
+
+    // Short slices hand over between the engines in the middle of the loop as well
+    for (int i = 0; i < 50; ++i) {
+        teakra.Run(7);
+    }
+    std::array<u16, 16> results{};
+    teakra.DataReadBlock(0x1000, results);
+    for (u16 i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i] == 3 * (i + 1));
+    }
+    REQUIRE(teakra.DataRead(0x1010) == 0);
+
+    // The loop got hot enough to compile, the setup at the entry did not
+    const auto stats = teakra.GetJitStats(100);
+    REQUIRE(!stats.top_variants.empty());
+    for (const auto& [pc, variants] : stats.top_variants) {
+        REQUIRE(pc != 0);
+    }
+}
+
+TEST_CASE("bkrep in a subroutine called twice from one block", "[jit]") {
+    const std::array<u16, 14> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x41C0, 0x000A, // call sub
+        0x41C0, 0x000A, // call sub
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+        0x5C03, 0x000C, // sub: bkrep 0x0003u8, end
+        0x67D0,         // end: inc a0
+        0x4580,         // ret
+    };
+    // Both calls are compiled into the entry block. The loop of the second one has to go back to
+    // its own copy of the body, not to the first one.
+    u16 expected{};
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        LoadProgram(teakra, program);
+        teakra.Run(200);
+        if (!use_jit) {
+            expected = teakra.DataRead(0x1000);
+            REQUIRE(expected == 8);
+        } else {
+            REQUIRE(teakra.DataRead(0x1000) == expected);
+        }
+    }
+}
+
+TEST_CASE("Tiered compilation recompiles a hot loop", "[jit]") {
+    const std::array<u16, 12> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x0CFF,         // loop: rep 0x00ffu8
+        0x67D0,         // inc a0
+        0x0CFF,         // rep 0x00ffu8
+        0x67D0,         // inc a0
+        0x77D0,         // inc a1
+        0xCDFF,         // cmp 0x00ffu8, a1
+        0x4182, 0x0002, // br loop, neq
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    // The loop runs on the interpreter, then on quick code, then well past HotBlockCycles on
+    // the optimized recompile
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        teakra.SetTieredCompilation(true);
+        LoadProgram(teakra, program);
+        for (int i = 0; i < 20; ++i) {
+            teakra.Run(10000);
+        }
+        REQUIRE(teakra.DataRead(0x1000) == static_cast<u16>(0xFF * 0x200));
+    }
+}
+
+TEST_CASE("Background compilation matches the interpreter", "[jit]") {
+    const std::array<u16, 17> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // loop: inc a0
+        0x41C0, 0x000E, // call sub
+        0x1B48,         // mov a0l, [r0++]
+        0xCC30,         // cmp 0x0030u8, a0
+        0x4182, 0x0004, // br loop, neq
+        0x1B68,         // mov a1l, [r0++]
+        0x57F0,         // brr -1
+        0x0000,         // nop
+        0xC602,         // sub: add 0x0002u8, a0
+        0x77D0,         // inc a1
+        0x4580,         // ret
+    };
+    // Every block misses once, and short slices leave the interpreter in the middle of the loop
+    // while compiles are still pending
+    std::array<u16, 0x20> expected{};
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        teakra.SetBackgroundCompilation(true);
+        LoadProgram(teakra, program);
+        for (int i = 0; i < 100; ++i) {
+            teakra.Run(5);
+        }
+        std::array<u16, 0x20> results{};
+        teakra.DataReadBlock(0x1000, results);
+        if (!use_jit) {
+            expected = results;
+            REQUIRE(expected[0xF] == 0x30);
+            REQUIRE(expected[0x10] == 0x10);
+        } else {
+            REQUIRE(results == expected);
+        }
+    }
+}
+
+TEST_CASE("Background compilation stopped while a compile is pending", "[jit]") {
+    const std::array<u16, 11> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // loop: inc a0
+        0x1B48,         // mov a0l, [r0++]
+        0xCC10,         // cmp 0x0010u8, a0
+        0x4182, 0x0002, // br loop, neq
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x1B60,         // mov a1l, [r0]
+        0x57F0,         // brr -1
+    };
+    for (const bool reset : {false, true}) {
+        Teakra::Teakra teakra(true);
+        teakra.SetBackgroundCompilation(true);
+        LoadProgram(teakra, program);
+        // The first slice misses at the entry and leaves its compile queued
+        teakra.Run(3);
+        if (reset) {
+            LoadProgram(teakra, program);
+        } else {
+            teakra.SetBackgroundCompilation(false);
+        }
+        teakra.Run(200);
+        std::array<u16, 0x10> results{};
+        teakra.DataReadBlock(0x1000, results);
+        // a1 is still clear, its store overwrites the first result
+        REQUIRE(results[0] == 0);
+        for (u16 i = 1; i < results.size(); ++i) {
+            REQUIRE(results[i] == i + 1);
+        }
+        REQUIRE(teakra.DataRead(0x1010) == 0);
+    }
+}
+
+TEST_CASE("Compiled blocks survive a reset unless the program changes", "[jit]") {
+    std::array<u16, 10> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x77D0,         // inc a1
+        0xCD00,         // cmp 0x0000u8, a1
+        0x4181, 0x0008, // br skip, eq
+        0x67D0,         // inc a0
+        0x67D0,         // inc a0
+        0x1B40,         // skip: mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    const auto has_block_at = [](const Teakra::JitStats& stats, u32 pc) {
+        return std::ranges::any_of(stats.top_variants,
+                                   [pc](const auto& entry) { return entry.first == pc; });
+    };
+    Teakra::Teakra teakra(true);
+    LoadProgram(teakra, program);
+    teakra.Run(20);
+    REQUIRE(teakra.DataRead(0x1000) == 2);
+    const auto cached_blocks = teakra.GetJitStats(100).cached_blocks;
+    REQUIRE(cached_blocks != 0);
+    REQUIRE(has_block_at(teakra.GetJitStats(100), 6));
+
+    // The same image again: nothing is dropped, and nothing new needs compiling
+    LoadProgram(teakra, program);
+    REQUIRE(teakra.GetJitStats(100).cached_blocks == cached_blocks);
+    teakra.Run(20);
+    REQUIRE(teakra.DataRead(0x1000) == 2);
+    REQUIRE(teakra.GetJitStats(100).cached_blocks == cached_blocks);
+
+    // One word changed between Reset and Run: the stale blocks go and the new code runs
+    program[2] = 0x67D0; // inc a0
+    LoadProgram(teakra, program);
+    teakra.Run(20);
+    REQUIRE(teakra.DataRead(0x1000) == 1);
+    REQUIRE(!has_block_at(teakra.GetJitStats(100), 6));
+}
+
+TEST_CASE("Straight-line run through the IR frontend", "[jit]") {
+    const std::array<u16, 25> program{
+        0x5E18, 0x1234, // mov 0x1234, a0
+        0x5E01, 0x00F0, // mov 0x00f0, r1
+        0x80C0, 0x0F0F, // or 0x0f0f, a0
+        0x82C0, 0xFF00, // and 0xff00, a0
+        0x84C0, 0x5555, // xor 0x5555, a0
+        0x585A,         // mov a0l, r2
+        0x5B21,         // mov r1, a1
+        0x81A2,         // or r2, a1
+        0x85C0, 0x00FF, // xor 0x00ff, a1
+        0xD4BC, 0x1000, // mov a0l, [0x1000]
+        0xD5BC, 0x1001, // mov a1l, [0x1001]
+        0x4181, 0x0016, // br skip, eq
+        0x67D0,         // inc a0
+        0xD4BC, 0x1002, // skip: mov a0l, [0x1002]
+        0x57F0,         // brr -1
+    };
+    // With TEAKRA_JIT_IR, the instructions before the branch are translated and optimized as one
+    // run. The branch reads the flags of the last xor, the only flag update left in it.
+    std::array<u16, 4> expected{};
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        LoadProgram(teakra, program);
+        teakra.Run(100);
+        std::array<u16, 4> results{};
+        teakra.DataReadBlock(0x1000, results);
+        if (!use_jit) {
+            expected = results;
+        } else {
+            REQUIRE(results == expected);
+        }
+    }
+}
+
+TEST_CASE("Stack pointer kept across calls, interrupts and block exits", "[jit]") {
+    const std::array<u16, 43> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x4180, 0x0008, // br start
+        0x0000,         // nop
+        0x0000,         // nop
+        0x4180, 0x0023, // br handler (interrupt 0 vector)
+        0x5E1A, 0x0001, // start: mov 0x0001, a0l
+        0xD4BC, 0x8206, // mov a0l, [0x8206] (route IRQ 0 to interrupt 0)
+        0x0037, 0x0180, // mov 0x0180, mod3 (enable interrupt 0)
+        0x5E1A, 0x1234, // mov 0x1234, a0l
+        0x5E5A,         // push a0l
+        0x41C0, 0x0027, // call sub
+        0x5E72,         // pop b0l
+        0xD5B8, 0x80D6, // mov [0x80d6], a1 (MMIO read through a call wrapper)
+        0x5E1A, 0x0001, // mov 0x0001, a0l
+        0xD4BC, 0x8204, // mov a0l, [0x8204] (raise IRQ 0)
+        0x0000,         // nop
+        0x0000,         // nop
+        0x5B2D,         // mov sp, a1
+        0xD5BC, 0x1000, // mov a1l, [0x1000]
+        0x5B32,         // mov b0l, a1
+        0xD5BC, 0x1003, // mov a1l, [0x1003]
+        0x57F0,         // brr -1
+        0x5B2D,         // handler: mov sp, a1
+        0xD5BC, 0x1002, // mov a1l, [0x1002]
+        0x45C0,         // reti
+        0x5B2D,         // sub: mov sp, a1
+        0xD5BC, 0x1001, // mov a1l, [0x1001]
+        0x4580,         // ret
+    };
+    std::array<u16, 4> expected{};
+    {
+        Teakra::Teakra teakra;
+        LoadProgram(teakra, program);
+        teakra.Run(1000);
+        teakra.DataReadBlock(0x1000, expected);
+        REQUIRE(expected[0] == 0x7000);
+        REQUIRE(expected[1] == 0x6FFD); // the pushed word and the return address
+        REQUIRE(expected[2] == 0x6FFE); // the return address
+        REQUIRE(expected[3] == 0x1234);
+    }
+    // Slices of one and a few cycles leave and reenter the blocks between any two instructions
+    for (const u32 slice : {1u, 3u, 1000u}) {
+        Teakra::Teakra teakra(true);
+        LoadProgram(teakra, program);
+        for (u32 cycles = 0; cycles < 1000; cycles += slice) {
+            teakra.Run(slice);
+        }
+        std::array<u16, 4> results{};
+        teakra.DataReadBlock(0x1000, results);
+        REQUIRE(results == expected);
+    }
+}
+
+TEST_CASE("JitStats counts dispatches and cycles", "[jit]") {
+    const std::array<u16, 5> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // inc a0
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    Teakra::Teakra teakra(true);
+    LoadProgram(teakra, program);
+    // The first Run enters the entry block, which ends in the idle loop, and the block of the idle
+    // loop, which skips what is left of the slice. The second one enters the idle loop twice: once
+    // to run it and once to skip.
+    teakra.Run(100);
+    teakra.Run(100);
+    REQUIRE(teakra.DataRead(0x1000) == 1);
+
+    const auto stats = teakra.GetJitStats();
+#ifdef TEAKRA_JIT_STATS
+    REQUIRE(stats.compiled_blocks == 2);
+    REQUIRE(stats.compiled_instructions == 5);
+    REQUIRE(stats.lookup_misses == 2);
+    REQUIRE(stats.lookup_hits == 2);
+    REQUIRE(stats.dispatches == 4);
+    REQUIRE(stats.cycles == 200);
+#else
+    REQUIRE(stats.compiled_blocks == 0);
+    REQUIRE(stats.dispatches == 0);
+    REQUIRE(stats.cycles == 0);
+#endif
+    REQUIRE(stats.cached_blocks == 2);
+    REQUIRE(stats.cached_pcs == 2);
+    REQUIRE(stats.code_bytes != 0);
+    REQUIRE(stats.top_variants == std::vector<std::pair<u32, u32>>{{0, 1}, {4, 1}});
+
+    Teakra::Teakra interpreter;
+    REQUIRE(interpreter.GetJitStats().code_bytes == 0);
+}
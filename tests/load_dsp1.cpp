@@ -0,0 +1,103 @@
+#include <cstring>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include <teakra/teakra_c.h>
+#include "../src/common_types.h"
+
+namespace {
+
+// Offsets into the 0x300 byte DSP1 header
+constexpr std::size_t MagicOffset = 0x100;
+constexpr std::size_t MemoryLayoutOffset = 0x108;
+constexpr std::size_t NumSegmentsOffset = 0x10E;
+constexpr std::size_t FlagsOffset = 0x10F;
+constexpr std::size_t SegmentsOffset = 0x120;
+constexpr std::size_t SegmentSize = 0x30;
+constexpr std::size_t HeaderSize = 0x300;
+
+struct Segment {
+    u32 address;
+    u8 memory_type;
+    std::vector<u16> words;
+};
+
+template <typename T>
+void Put(std::vector<u8>& image, std::size_t offset, T value) {
+    std::memcpy(image.data() + offset, &value, sizeof(value));
+}
+
+std::vector<u8> MakeImage(const std::vector<Segment>& segments, u16 memory_layout = 0,
+                          u8 flags = 0) {
+    std::vector<u8> image(HeaderSize);
+    std::memcpy(image.data() + MagicOffset, "DSP1", 4);
+    Put(image, MemoryLayoutOffset, memory_layout);
+    Put(image, NumSegmentsOffset, static_cast<u8>(segments.size()));
+    Put(image, FlagsOffset, flags);
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        const auto& segment = segments[i];
+        const std::size_t entry = SegmentsOffset + i * SegmentSize;
+        Put(image, entry, static_cast<u32>(image.size()));
+        Put(image, entry + 4, segment.address);
+        Put(image, entry + 8, static_cast<u32>(segment.words.size() * 2));
+        Put(image, entry + 0xF, segment.memory_type);
+        const std::size_t offset = image.size();
+        image.resize(offset + segment.words.size() * 2);
+        std::memcpy(image.data() + offset, segment.words.data(), segment.words.size() * 2);
+    }
+    return image;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("LoadDsp1 copies the segments", "[dsp1]") {
+    Teakra::Teakra teakra;
+    const auto image = MakeImage({{0x0010, 0, {0x1111, 0x2222}}, {0x0100, 2, {0x3333}}}, 0x1234, 1);
+    const auto info = teakra.LoadDsp1(image);
+    REQUIRE(info);
+    REQUIRE(info->memory_layout == 0x1234);
+    REQUIRE(info->recv_data_on_start);
+    REQUIRE(teakra.ProgramRead(0x0010) == 0x1111);
+    REQUIRE(teakra.ProgramRead(0x0011) == 0x2222);
+    REQUIRE(teakra.DataRead(0x0100) == 0x3333);
+}
+
+TEST_CASE("LoadDsp1 rejects malformed images", "[dsp1]") {
+    Teakra::Teakra teakra;
+    auto image = MakeImage({{0x0010, 0, {0x1111}}, {0x0100, 2, {0x3333}}});
+
+    SECTION("Too short for the header") {
+        image.resize(HeaderSize - 1);
+    }
+    SECTION("Wrong magic") {
+        image[MagicOffset] = 'X';
+    }
+    SECTION("Too many segments") {
+        image[NumSegmentsOffset] = 11;
+    }
+    SECTION("Unknown memory type") {
+        image[SegmentsOffset + SegmentSize + 0xF] = 3;
+    }
+    SECTION("Segment past the end of the image") {
+        image.pop_back();
+    }
+    SECTION("Segment past the end of its memory") {
+        Put(image, SegmentsOffset + SegmentSize + 4, u32{0x20000});
+    }
+
+    // Nothing is loaded, not even the segments before the bad one
+    REQUIRE(!teakra.LoadDsp1(image));
+    REQUIRE(teakra.ProgramRead(0x0010) == 0);
+}
+
+TEST_CASE("Teakra_LoadDsp1 reports the image settings", "[dsp1]") {
+    TeakraContext* context = Teakra_Create();
+    const auto image = MakeImage({{0x0010, 0, {0x1111}}}, 0x0042, 1);
+    Teakra_Dsp1Info info{};
+    REQUIRE(Teakra_LoadDsp1(context, image.data(), image.size(), false, &info));
+    REQUIRE(info.memory_layout == 0x0042);
+    REQUIRE(info.recv_data_on_start);
+    REQUIRE(Teakra_LoadDsp1(context, image.data(), image.size(), false, nullptr));
+    REQUIRE(!Teakra_LoadDsp1(context, image.data(), HeaderSize - 1, false, &info));
+    Teakra_Destroy(context);
+}
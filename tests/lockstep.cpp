@@ -0,0 +1,33 @@
+#include <array>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/common_types.h"
+
+TEST_CASE("Lockstep verification of a fresh image", "[lockstep]") {
+    Teakra::Teakra teakra(true);
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+    teakra.SetLockstepVerification(true);
+
+    const std::array<u16, 12> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x67D0,         // loop: inc a0
+        0x41C0, 0x000A, // call sub
+        0x1B48,         // mov a0l, [r0++]
+        0x4180, 0x0004, // br loop
+        0xC602,         // sub: add 0x0002u8, a0
+        0x4580,         // ret
+    };
+    teakra.ProgramWriteBlock(0, program);
+
+    // Every block is compiled for the first time while being verified
+    teakra.Run(1000);
+    REQUIRE(teakra.GetLockstepReport().empty());
+
+    std::array<u16, 16> results{};
+    teakra.DataReadBlock(0x1000, results);
+    for (u16 i = 0; i < results.size(); ++i) {
+        REQUIRE(results[i] == 3 * (i + 1));
+    }
+}
@@ -0,0 +1,65 @@
+#include <array>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/common_types.h"
+
+TEST_CASE("Peripheral stats count a DMA transfer", "[peripheral_stats]") {
+    const std::array<u16, 37> program{
+        0x5E1A, 0x0000, // mov 0x0000, a0l
+        0xD4BC, 0x81BE, // mov a0l, [0x81be] (channel 0)
+        0xD4BC, 0x81C2, // mov a0l, [0x81c2]
+        0xD4BC, 0x81C6, // mov a0l, [0x81c6]
+        0xD4BC, 0x81DA, // mov a0l, [0x81da] (data memory to data memory, word mode)
+        0x5E1A, 0x1000, // mov 0x1000, a0l
+        0xD4BC, 0x81C0, // mov a0l, [0x81c0] (source)
+        0x5E1A, 0x2000, // mov 0x2000, a0l
+        0xD4BC, 0x81C4, // mov a0l, [0x81c4] (destination)
+        0x5E1A, 0x0100, // mov 0x0100, a0l
+        0xD4BC, 0x81C8, // mov a0l, [0x81c8] (0x100 words)
+        0x5E1A, 0x0001, // mov 0x0001, a0l
+        0xD4BC, 0x81CA, // mov a0l, [0x81ca]
+        0xD4BC, 0x81CC, // mov a0l, [0x81cc]
+        0xD4BC, 0x81CE, // mov a0l, [0x81ce]
+        0xD4BC, 0x81D0, // mov a0l, [0x81d0]
+        0x5E1A, 0x40C0, // mov 0x40c0, a0l
+        0xD4BC, 0x81DE, // mov a0l, [0x81de] (start)
+        0x57F0,         // brr -1
+    };
+    std::array<u16, 0x100> source;
+    for (u16 i = 0; i < source.size(); ++i) {
+        source[i] = static_cast<u16>(0x5A00 + i);
+    }
+
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        teakra.SetAudioCallback([](std::array<s16, 2>) {});
+        teakra.Reset();
+        teakra.ProgramWriteBlock(0, program);
+        teakra.DataWriteBlock(0x1000, source);
+        teakra.SetPeripheralStats(true);
+        teakra.Run(100);
+        // The CPU side is counted as well
+        teakra.MMIORead(0x1C8);
+
+        std::array<u16, 0x100> copy{};
+        teakra.DataReadBlock(0x2000, copy);
+        REQUIRE(copy == source);
+
+        const auto stats = teakra.GetPeripheralStats();
+        REQUIRE(stats.dma_bytes[0][0] == 0x200);
+        REQUIRE(stats.dma_bytes[0][7] == 0);
+        REQUIRE(stats.mmio_writes[0x1CE] == 1);
+        REQUIRE(stats.mmio_writes[0x1DE] == 1);
+        REQUIRE(stats.mmio_reads[0x1C8] == 1);
+        REQUIRE(stats.mmio_reads[0x1DE] == 0);
+        // The DMA interrupt request on completion
+        REQUIRE(stats.irqs[15] == 1);
+
+        // Disabling stops counting, and enabling again starts from zero
+        teakra.SetPeripheralStats(false);
+        teakra.MMIORead(0x1C8);
+        teakra.SetPeripheralStats(true);
+        REQUIRE(teakra.GetPeripheralStats().mmio_reads[0x1C8] == 0);
+        REQUIRE(teakra.GetPeripheralStats().dma_bytes[0][0] == 0);
+    }
+}
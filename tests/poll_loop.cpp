@@ -0,0 +1,60 @@
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/common_types.h"
+#include "../src/trace.h"
+
+namespace {
+
+u64 CountIdleEvents(const std::filesystem::path& path) {
+    std::FILE* file = std::fopen(path.string().c_str(), "rb");
+    REQUIRE(file);
+    Teakra::TraceFileHeader header;
+    REQUIRE(std::fread(&header, sizeof(header), 1, file) == 1);
+    std::vector<Teakra::TraceEvent> events(header.count);
+    REQUIRE(std::fread(events.data(), sizeof(Teakra::TraceEvent), events.size(), file) ==
+            events.size());
+    std::fclose(file);
+
+    u64 count = 0;
+    for (const auto& event : events) {
+        count += event.type == Teakra::TraceEventType::Idle;
+    }
+    return count;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Polling loop closed by a conditional br", "[poll]") {
+    const std::array<u16, 11> program{
+        0x5E0D, 0x7000, // mov 0x7000, sp
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x1F40,         // loop: mov [r0], a0l
+        0xCC00,         // cmp 0x0000u8, a0
+        0x4181, 0x0004, // br loop, eq
+        0x67D0,         // inc a0
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    const bool use_jit = GENERATE(false, true);
+    Teakra::Teakra teakra(use_jit);
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+    teakra.ProgramWriteBlock(0, program);
+
+    // Both engines find the fixed point of the loop and skip ahead instead of spinning
+    teakra.StartTrace(1 << 12);
+    teakra.Run(1000);
+    const auto path = std::filesystem::temp_directory_path() / "teakra_poll_loop.trace";
+    REQUIRE(teakra.WriteTrace(path.string()));
+    REQUIRE(CountIdleEvents(path) > 0);
+    std::filesystem::remove(path);
+
+    // The loop still leaves as soon as memory changes
+    teakra.DataWrite(0x1000, 1);
+    teakra.Run(100);
+    REQUIRE(teakra.DataRead(0x1000) == 2);
+}
@@ -0,0 +1,57 @@
+#include <array>
+#include <cstdio>
+#include <map>
+#include <span>
+#include <sstream>
+#include <string>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/common_types.h"
+
+namespace {
+
+// The cycles charged to each pc in a profiler report
+std::map<u32, u64> ReportCycles(const std::string& report) {
+    std::map<u32, u64> result;
+    std::istringstream lines(report);
+    std::string line;
+    std::getline(lines, line); // totals
+    std::getline(lines, line); // column names
+    while (std::getline(lines, line)) {
+        unsigned pc;
+        unsigned long long samples, cycles;
+        REQUIRE(std::sscanf(line.c_str(), "%x %llu %llu", &pc, &samples, &cycles) == 3);
+        result[pc] = cycles;
+    }
+    return result;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Profiler charges instructions or block entries", "[profiler]") {
+    const std::array<u16, 6> program{
+        0x67D0,         // loop: inc a0
+        0xCC10,         // cmp 0x0010u8, a0
+        0x4182, 0x0000, // br loop, neq
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    for (const bool use_jit : {false, true}) {
+        Teakra::Teakra teakra(use_jit);
+        teakra.SetAudioCallback([](std::array<s16, 2>) {});
+        teakra.Reset();
+        teakra.ProgramWriteBlock(0, program);
+        teakra.StartProfiler(1);
+        teakra.Run(100);
+        teakra.StopProfiler();
+
+        const auto cycles = ReportCycles(teakra.GetProfilerReport());
+        if (!use_jit) {
+            // Every instruction, the idle skip included
+            REQUIRE(cycles == std::map<u32, u64>{{0, 16}, {1, 16}, {2, 16}, {4, 1}, {5, 51}});
+        } else {
+            // The loop body is one block, charged to its entry
+            REQUIRE(cycles == std::map<u32, u64>{{0, 48}, {4, 2}, {5, 50}});
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#include <array>
+#include <atomic>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include <teakra/teakra_pool.h>
+#include "../src/common_types.h"
+
+TEST_CASE("TeakraPool runs independent instances", "[pool]") {
+    const std::array<u16, 6> program{
+        0x5E00, 0x1000, // mov 0x1000, r0
+        0x1F40,         // mov [r0], a0l
+        0x67D0,         // inc a0
+        0x1B40,         // mov a0l, [r0]
+        0x57F0,         // brr -1
+    };
+    Teakra::TeakraPool pool(5, 2);
+    REQUIRE(pool.GetInstanceCount() == 5);
+    REQUIRE(pool.GetThreadCount() == 2);
+
+    std::vector<std::atomic<int>> visits(pool.GetInstanceCount());
+    pool.ForEach([&](std::size_t index, Teakra::Teakra& teakra) {
+        visits[index]++;
+        teakra.SetAudioCallback([](std::array<s16, 2>) {});
+        teakra.Reset();
+        teakra.ProgramWriteBlock(0, program);
+        teakra.DataWrite(0x1000, static_cast<u16>(index * 10));
+    });
+    for (const auto& count : visits) {
+        REQUIRE(count == 1);
+    }
+
+    pool.Run(100);
+    for (std::size_t i = 0; i < pool.GetInstanceCount(); ++i) {
+        REQUIRE(pool.GetInstance(i).DataRead(0x1000) == i * 10 + 1);
+    }
+}
+
+TEST_CASE("TeakraPool thread count", "[pool]") {
+    // Never more threads than instances, and at least one
+    REQUIRE(Teakra::TeakraPool(3, 8).GetThreadCount() == 3);
+    REQUIRE(Teakra::TeakraPool(0, 4).GetThreadCount() == 1);
+    REQUIRE(Teakra::TeakraPool(2).GetThreadCount() >= 1);
+}
@@ -0,0 +1,85 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include "../src/common_types.h"
+#include "../src/test_container.h"
+
+namespace {
+
+TestCase MakeCase(std::mt19937& rng, u16 opcode, std::size_t num_changes) {
+    TestCase test_case{};
+    test_case.opcode = opcode;
+    test_case.expand = static_cast<u16>(rng());
+    std::vector<u8> bytes(sizeof(State));
+    for (auto& byte : bytes) {
+        byte = static_cast<u8>(rng());
+    }
+    std::memcpy(&test_case.before, bytes.data(), sizeof(State));
+    test_case.after = test_case.before;
+    test_case.after.r[0] ^= 0x1234;
+    for (std::size_t i = 0; i < num_changes; ++i) {
+        const std::size_t word = rng() % (2 * TestSpaceSize);
+        auto& space = word < TestSpaceSize ? test_case.after.test_space_x
+                                           : test_case.after.test_space_y;
+        space[word % TestSpaceSize] ^= static_cast<u16>(rng() | 1);
+    }
+    return test_case;
+}
+
+bool SameCase(const TestCase& lhs, const TestCase& rhs) {
+    return lhs.opcode == rhs.opcode && lhs.expand == rhs.expand &&
+           std::memcmp(&lhs.before, &rhs.before, sizeof(State)) == 0 &&
+           std::memcmp(&lhs.after, &rhs.after, sizeof(State)) == 0;
+}
+
+std::vector<u8> ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+} // Anonymous namespace
+
+TEST_CASE("Test container round trip", "[test_container]") {
+    std::mt19937 rng(42);
+    const std::vector<TestCase> cases{
+        MakeCase(rng, 0x8000, 0), MakeCase(rng, 0x1234, 3),
+        MakeCase(rng, 0x8000, 1), MakeCase(rng, 0x0001, 2 * TestSpaceSize),
+        MakeCase(rng, 0x1234, 5),
+    };
+
+    const auto path = std::filesystem::temp_directory_path() / "teakra_test_container.bin";
+    Teakra::Test::ContainerWriter writer;
+    REQUIRE(writer.Open(path.string().c_str()));
+    for (const auto& test_case : cases) {
+        REQUIRE(writer.Write(test_case));
+    }
+    REQUIRE(writer.Close());
+    const std::vector<u8> data = ReadFile(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(Teakra::Test::IsContainer(data));
+    Teakra::Test::ContainerReader reader;
+    REQUIRE(reader.Open(data));
+    REQUIRE(reader.NumCases() == cases.size());
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        REQUIRE(SameCase(reader.Get(i), cases[i]));
+    }
+
+    const auto with_opcode = [&](u16 opcode) {
+        const auto numbers = reader.CasesWithOpcode(opcode);
+        return std::vector<u32>(numbers.begin(), numbers.end());
+    };
+    REQUIRE(with_opcode(0x8000) == std::vector<u32>{0, 2});
+    REQUIRE(with_opcode(0x1234) == std::vector<u32>{1, 4});
+    REQUIRE(with_opcode(0x0001) == std::vector<u32>{3});
+    REQUIRE(with_opcode(0x4000).empty());
+
+    // The index is at the end, so a cut off file is rejected as a whole
+    std::vector<u8> truncated(data.begin(), data.end() - 1);
+    REQUIRE(!reader.Open(truncated));
+    REQUIRE(!Teakra::Test::IsContainer(std::span<const u8>(data).first(4)));
+}
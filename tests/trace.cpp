@@ -0,0 +1,114 @@
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include <catch2/catch_all.hpp>
+#include <teakra/teakra.h>
+#include "../src/common_types.h"
+#include "../src/trace.h"
+
+namespace {
+
+struct ExpectedEvent {
+    u64 cycle;
+    u32 address;
+    u16 value;
+    Teakra::TraceEventType type;
+};
+
+} // Anonymous namespace
+
+TEST_CASE("Trace file of a short run", "[trace]") {
+    const std::array<u16, 5> program{
+        0x5E1A, 0x0001, // mov 0x0001, a0l
+        0xD4BC, 0x81BE, // mov a0l, [0x81be]
+        0x57F0,         // brr -1
+    };
+    using enum Teakra::TraceEventType;
+    const bool use_jit = GENERATE(false, true);
+    // The JIT records the blocks it enters instead of instructions, and stamps the accesses in a
+    // block with the cycle of its entry
+    const std::vector<ExpectedEvent> expected =
+        use_jit ? std::vector<ExpectedEvent>{{0, 0x0, 0, Block},
+                                             {0, 0x1BE, 1, MMIOWrite},
+                                             {3, 0x4, 0, Block},
+                                             {3, 0x4, 0, Idle}}
+                : std::vector<ExpectedEvent>{{0, 0x0, 0, Instruction},
+                                             {1, 0x2, 0, Instruction},
+                                             {2, 0x1BE, 1, MMIOWrite},
+                                             {2, 0x4, 0, Instruction},
+                                             {3, 0x4, 0, Idle},
+                                             {9, 0x4, 0, Instruction}};
+
+    Teakra::Teakra teakra(use_jit);
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+    teakra.ProgramWriteBlock(0, program);
+    teakra.StartTrace(1 << 4);
+    teakra.Run(10);
+    const auto path = std::filesystem::temp_directory_path() / "teakra_short_run.trace";
+    REQUIRE(teakra.WriteTrace(path.string()));
+
+    std::FILE* file = std::fopen(path.string().c_str(), "rb");
+    REQUIRE(file);
+    Teakra::TraceFileHeader header;
+    REQUIRE(std::fread(&header, sizeof(header), 1, file) == 1);
+    REQUIRE(header.magic == Teakra::TraceMagic);
+    REQUIRE(header.version == Teakra::TraceVersion);
+    REQUIRE(header.first == 0);
+    REQUIRE(header.count == expected.size());
+    REQUIRE(header.program_words == 0x20000);
+    std::vector<Teakra::TraceEvent> events(header.count);
+    std::array<u16, 5> program_words{};
+    REQUIRE(std::fread(events.data(), sizeof(Teakra::TraceEvent), events.size(), file) ==
+            events.size());
+    REQUIRE(std::fread(program_words.data(), sizeof(u16), program_words.size(), file) ==
+            program_words.size());
+    std::fclose(file);
+    std::filesystem::remove(path);
+
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        INFO("event " << i);
+        REQUIRE(events[i].type == expected[i].type);
+        REQUIRE(events[i].cycle == expected[i].cycle);
+        REQUIRE(events[i].address == expected[i].address);
+        REQUIRE(events[i].value == expected[i].value);
+    }
+    // The decoder disassembles the events with the program stored after them
+    REQUIRE(program_words == program);
+}
+
+TEST_CASE("Trace ring buffer keeps the newest events", "[trace]") {
+    const std::array<u16, 4> program{
+        0x67D0,         // loop: inc a0
+        0x4180, 0x0000, // br loop
+        0x0000,         // nop
+    };
+    Teakra::Teakra teakra;
+    teakra.SetAudioCallback([](std::array<s16, 2>) {});
+    teakra.Reset();
+    teakra.ProgramWriteBlock(0, program);
+    teakra.StartTrace(1 << 4);
+    teakra.Run(100);
+    const auto path = std::filesystem::temp_directory_path() / "teakra_ring.trace";
+    REQUIRE(teakra.WriteTrace(path.string()));
+
+    std::FILE* file = std::fopen(path.string().c_str(), "rb");
+    REQUIRE(file);
+    Teakra::TraceFileHeader header;
+    REQUIRE(std::fread(&header, sizeof(header), 1, file) == 1);
+    std::vector<Teakra::TraceEvent> events(header.count);
+    REQUIRE(std::fread(events.data(), sizeof(Teakra::TraceEvent), events.size(), file) ==
+            events.size());
+    std::fclose(file);
+    std::filesystem::remove(path);
+
+    // One event per instruction. A full buffer leaves out the oldest slot, which a running DSP
+    // could be overwriting.
+    REQUIRE(header.first == 100 - 15);
+    REQUIRE(header.count == 15);
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        REQUIRE(events[i].cycle == header.first + i);
+        REQUIRE(events[i].address == (header.first + i) % 2);
+    }
+}